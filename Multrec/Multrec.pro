@@ -5,7 +5,8 @@ TARGET = Multrec
 CONFIG   += console c++11
 CONFIG   -= app_bundle
 
-QMAKE_CXXFLAGS += -std=c++0x
+QMAKE_CXXFLAGS += -std=c++0x -pthread
+QMAKE_LFLAGS += -pthread
 
 TEMPLATE = app
 
@@ -15,7 +16,16 @@ SOURCES += main.cpp \
     trees/node.cpp \
     trees/treeinfo.cpp \
     trees/treeiterator.cpp \
-    multigenereconciler.cpp
+    trees/lcaindex.cpp \
+    trees/nodeforest.cpp \
+    trees/flattree.cpp \
+    trees/speciesnameindex.cpp \
+    multigenereconciler.cpp \
+    reconcilerlowerbounds.cpp \
+    transpositiontable.cpp \
+    astarsearch.cpp \
+    div/workstealingpool.cpp \
+    div/stringpool.cpp
 
 HEADERS += \
     trees/genespeciestreeutil.h \
@@ -23,7 +33,17 @@ HEADERS += \
     trees/node.h \
     trees/treeinfo.h \
     trees/treeiterator.h \
+    trees/treetraversal.h \
+    trees/lcaindex.h \
+    trees/nodeforest.h \
+    trees/flattree.h \
+    trees/speciesnameindex.h \
     div/define.h \
     div/tinydir.h \
     div/util.h \
-    multigenereconciler.h
+    div/workstealingpool.h \
+    div/stringpool.h \
+    multigenereconciler.h \
+    reconcilerlowerbounds.h \
+    transpositiontable.h \
+    astarsearch.h
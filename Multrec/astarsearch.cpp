@@ -0,0 +1,283 @@
+#include "astarsearch.h"
+
+#include <algorithm>
+
+/**
+See astarsearch.h for documentation on methods in this class.
+**/
+
+
+bool AStarOpenEntryOrder::operator()(const AStarOpenEntry &a, const AStarOpenEntry &b) const
+{
+    if (a.estimate != b.estimate)
+        return a.estimate > b.estimate;
+
+    return search->IsBefore(b.node, a.node);
+}
+
+
+
+AStarSearch::AStarSearch(MultiGeneReconciler* reconciler, size_t memoryLimit)
+    : open(AStarOpenEntryOrder(this))
+{
+    this->reconciler = reconciler;
+    this->maxNbNodes = max((size_t)1, memoryLimit / (sizeof(AStarSearchNode) + sizeof(AStarOpenEntry)));
+    this->nbExpanded = 0;
+    this->fallenBack = false;
+    this->state = NULL;
+}
+
+
+
+void AStarSearch::Run(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info)
+{
+    this->state = &state;
+    this->rootPath = state.path;
+
+    AStarSearchNode root;
+    root.parent = -1;
+    root.depth = 0;
+    root.species = -1;
+    root.branchIndex = -1;
+    root.nbLosses = info.nbLosses;
+    root.dupHeightSum = info.dupHeightSum;
+
+    double estimate;
+    if (Evaluate(root, estimate))
+    {
+        nodes.push_back(root);
+        open.push(AStarOpenEntry(estimate, 0));
+    }
+
+    while (!open.empty() && !CannotImprove(open.top()))
+    {
+        //the first entry has the smallest estimate, so it bounds all the open nodes
+        if (reconciler->IsStopped())
+        {
+            reconciler->AddAbandonedBranch(open.top().estimate);
+            break;
+        }
+
+        if (nodes.size() >= maxNbNodes)
+        {
+            fallenBack = true;
+            break;
+        }
+
+        int node = open.top().node;
+        open.pop();
+        Expand(node);
+    }
+
+    //out of memory: the open nodes are explored depth-first, the most promising first
+    while (!open.empty() && !CannotImprove(open.top()))
+    {
+        if (reconciler->IsStopped())
+        {
+            reconciler->AddAbandonedBranch(open.top().estimate);
+            break;
+        }
+
+        int node = open.top().node;
+        open.pop();
+        MoveTo(node);
+
+        MultiGeneReconcilerInfo nodeInfo;
+        nodeInfo.nbLosses = nodes[node].nbLosses;
+        nodeInfo.dupHeightSum = nodes[node].dupHeightSum;
+        reconciler->ReconcileRecursive(state, nodeInfo);
+    }
+
+    MoveTo(0);
+    nodes.clear();
+    open = priority_queue<AStarOpenEntry, vector<AStarOpenEntry>, AStarOpenEntryOrder>(AStarOpenEntryOrder(this));
+}
+
+
+
+bool AStarSearch::IsBefore(int a, int b)
+{
+    //bring both to the same depth.  If one is an ancestor of the other, its path is a prefix of the other, hence smaller
+    int x = a;
+    int y = b;
+    while (nodes[x].depth > nodes[y].depth)
+        x = nodes[x].parent;
+    while (nodes[y].depth > nodes[x].depth)
+        y = nodes[y].parent;
+
+    if (x == y)
+        return nodes[a].depth < nodes[b].depth;
+
+    //then go up to the children of their lowest common ancestor, where the paths differ
+    while (nodes[x].parent != nodes[y].parent)
+    {
+        x = nodes[x].parent;
+        y = nodes[y].parent;
+    }
+
+    return nodes[x].branchIndex < nodes[y].branchIndex;
+}
+
+
+
+vector<int> AStarSearch::GetPath(int node)
+{
+    vector<int> path;
+    for (int n = node; n > 0; n = nodes[n].parent)
+    {
+        path.push_back(nodes[n].branchIndex);
+    }
+    path.insert(path.end(), rootPath.rbegin(), rootPath.rend());
+    reverse(path.begin(), path.end());
+
+    return path;
+}
+
+
+
+bool AStarSearch::CannotImprove(const AStarOpenEntry &entry)
+{
+    double incumbentCost = reconciler->incumbentCost.load(memory_order_relaxed);
+
+    if (entry.estimate > incumbentCost)
+        return true;
+
+    //a solution of equal cost must come before the incumbent.  The path of entry is not a prefix of the one of the incumbent
+    //if it comes after it, so the paths of all its descendants also come after.
+    if (entry.estimate == incumbentCost)
+    {
+        vector<int> path = GetPath(entry.node);
+        return (reconciler->currentBestPath < path);
+    }
+
+    return false;
+}
+
+
+
+void AStarSearch::MoveTo(int node)
+{
+    //the ancestors of node, from the one below the root down to node
+    vector<int> chain;
+    for (int n = node; n > 0; n = nodes[n].parent)
+    {
+        chain.push_back(n);
+    }
+    reverse(chain.begin(), chain.end());
+
+    //undo the branchings below the last common ancestor with the current node
+    int common = 0;
+    while (common < chain.size() && common < currentNodes.size() && chain[common] == currentNodes[common])
+    {
+        common++;
+    }
+
+    if (common < currentNodes.size())
+    {
+        state->Undo(currentTrailSizes[common]);
+        state->topsHash = currentTopsHashes[common];
+        state->path.resize(state->path.size() - (currentNodes.size() - common));
+
+        currentNodes.resize(common);
+        currentTrailSizes.resize(common);
+        currentTopsHashes.resize(common);
+    }
+
+    //and replay the others.  The lowest minimal node only depends on the state, so we get the same one as when the node was created.
+    for (int i = common; i < chain.size(); i++)
+    {
+        currentNodes.push_back(chain[i]);
+        currentTrailSizes.push_back(state->GetTrailSize());
+        currentTopsHashes.push_back(state->topsHash);
+
+        int lowest = reconciler->GetLowestMinimalNode(*state);
+        vector<int> minimalNodes(state->frontier.begin(), state->frontier.begin() + state->frontierSize);
+        reconciler->ApplyBranch(*state, minimalNodes, lowest, nodes[chain[i]].species);
+        state->path.push_back(nodes[chain[i]].branchIndex);
+    }
+}
+
+
+
+void AStarSearch::Expand(int node)
+{
+    MoveTo(node);
+    nbExpanded++;
+
+    int lowest = reconciler->GetLowestMinimalNode(*state);
+    vector<int> sps = reconciler->GetPossibleSpeciesMapping(lowest, state->partialMapping);
+    vector<int> minimalNodes(state->frontier.begin(), state->frontier.begin() + state->frontierSize);
+
+    for (int i = 0; i < sps.size(); i++)
+    {
+        int trailSize = state->GetTrailSize();
+        uint64 topsHash = state->topsHash;
+
+        AStarSearchNode child;
+        child.parent = node;
+        child.depth = nodes[node].depth + 1;
+        child.species = sps[i];
+        child.branchIndex = i;
+        child.nbLosses = nodes[node].nbLosses + reconciler->ApplyBranch(*state, minimalNodes, lowest, sps[i]);
+        child.dupHeightSum = nodes[node].dupHeightSum + 1;
+
+        state->path.push_back(i);
+
+        double estimate;
+        if (Evaluate(child, estimate))
+        {
+            nodes.push_back(child);
+            open.push(AStarOpenEntry(estimate, nodes.size() - 1));
+        }
+
+        state->path.pop_back();
+        state->Undo(trailSize);
+        state->topsHash = topsHash;
+    }
+}
+
+
+
+bool AStarSearch::Evaluate(AStarSearchNode &node, double &estimate)
+{
+    //same checks as ReconcileRecursive.  When a limit is reached, the open list accounts for the abandoned nodes, see Run.
+    reconciler->VisitNode();
+
+    MultiGeneReconcilerInfo info;
+    info.nbLosses = node.nbLosses;
+    info.dupHeightSum = node.dupHeightSum;
+
+    if (info.dupHeightSum > reconciler->maxDupHeight)
+    {
+        reconciler->AddPrunedBranch(info.GetCost(reconciler->dupcost, reconciler->losscost), info.dupHeightSum);
+        return false;
+    }
+
+    if (reconciler->incumbentCost.load(memory_order_relaxed) < info.GetCost(reconciler->dupcost, reconciler->losscost))
+        return false;
+
+    if (state->frontierSize == 0)
+    {
+        reconciler->UpdateIncumbent(*state, info);
+        return false;
+    }
+
+    MultiGeneReconcilerInfo boundInfo;
+    reconciler->GetLowerBound(*state, boundInfo.dupHeightSum, boundInfo.nbLosses);
+    boundInfo.dupHeightSum += info.dupHeightSum;
+    boundInfo.nbLosses += info.nbLosses;
+    estimate = boundInfo.GetCost(reconciler->dupcost, reconciler->losscost);
+
+    if (boundInfo.dupHeightSum > reconciler->maxDupHeight)
+    {
+        reconciler->AddPrunedBranch(estimate, boundInfo.dupHeightSum);
+        return false;
+    }
+
+    //see CannotImprove
+    double incumbentCost = reconciler->incumbentCost.load(memory_order_relaxed);
+    if (estimate > incumbentCost || (estimate == incumbentCost && reconciler->currentBestPath < state->path))
+        return false;
+
+    return true;
+}
@@ -0,0 +1,160 @@
+#ifndef ASTARSEARCH_H
+#define ASTARSEARCH_H
+
+#include <deque>
+#include <queue>
+#include "multigenereconciler.h"
+
+using namespace std;
+
+
+/**
+ * @brief The AStarSearchNode class is a node of the A* search tree.  Only the branching that leads to it from its parent is stored,
+ * i.e. the species given to the lowest minimal node of the parent, along with its losses and dup heights.  Its state is rebuilt
+ * by replaying the branchings from the root.
+ */
+class AStarSearchNode
+{
+public:
+    //index of the parent in AStarSearch::nodes, -1 for the root
+    int parent;
+    int depth;
+
+    //the species given to the lowest minimal node of the parent, and its position among the possible species
+    //(the entry of MultiGeneReconcilerState::path)
+    int species;
+    int branchIndex;
+
+    int nbLosses;
+    int dupHeightSum;
+};
+
+
+
+/**
+ * @brief The AStarOpenEntry class is an entry of the open list of the A* search: a node and its cost + lower bound.
+ */
+class AStarOpenEntry
+{
+public:
+    double estimate;
+    int node;
+
+    AStarOpenEntry(double estimate, int node)
+    {
+        this->estimate = estimate;
+        this->node = node;
+    }
+};
+
+
+class AStarSearch;
+
+/**
+ * @brief The AStarOpenEntryOrder class orders the open list: the entry with the smallest cost + lower bound comes first,
+ * and entries with the same estimate come in the order of the depth-first search (see AStarSearch::IsBefore).
+ */
+class AStarOpenEntryOrder
+{
+public:
+    AStarOpenEntryOrder(AStarSearch* search)
+    {
+        this->search = search;
+    }
+
+    //priority_queue gives the largest entry first, so the largest entry here is the one to expand first
+    bool operator()(const AStarOpenEntry &a, const AStarOpenEntry &b) const;
+
+private:
+    AStarSearch* search;
+};
+
+
+
+/**
+ * @brief The AStarSearch class explores the search tree of a MultiGeneReconciler best-first instead of depth-first:
+ * it always expands the open node with the smallest cost + lower bound (see MultiGeneReconciler::GetLowerBound).
+ * Since the bound is admissible, the search can stop as soon as every open node is worse than the incumbent.\n
+ * To return the same solution as the depth-first search, which keeps the solution of minimum cost with the smallest path, nodes
+ * of equal estimates are expanded in the order of their paths.  A node whose estimate equals the cost of the incumbent is then
+ * only expanded if its path comes before the one of the incumbent, since otherwise all of its descendants come after.\n
+ * The search keeps a single MultiGeneReconcilerState, and moves it from one node to the next by undoing branchings up to their common
+ * ancestor and replaying the others.  The nodes themselves only store their branching.  When they would use more memory than allowed,
+ * the remaining open nodes are explored depth-first with MultiGeneReconciler::ReconcileRecursive, from the most promising one.
+ */
+class AStarSearch
+{
+public:
+    /**
+     * @brief AStarSearch
+     * @param reconciler The reconciler whose search tree is explored.  Its incumbent must be initialized.
+     * @param memoryLimit Maximum memory used by the nodes and the open list, in bytes.
+     */
+    AStarSearch(MultiGeneReconciler* reconciler, size_t memoryLimit);
+
+    /**
+     * @brief Run Explores the search tree under state, whose mapping must be clean and have the losses and dup heights of info.
+     * Complete mappings go to the incumbent of the reconciler.  The state is left as it was received.
+     */
+    void Run(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info);
+
+    /**
+     * @brief GetNbExpanded Returns the number of nodes expanded by the best-first search (not counting the depth-first fallback).
+     */
+    uint64 GetNbExpanded()
+    {
+        return nbExpanded;
+    }
+
+    /**
+     * @brief HasFallenBack Returns true iff the memory limit was reached and the search finished depth-first.
+     */
+    bool HasFallenBack()
+    {
+        return fallenBack;
+    }
+
+    /**
+     * @brief IsBefore Returns true iff the path of node a is lexicographically smaller than the one of node b,
+     * i.e. a comes before b in the depth-first search.  Takes time proportional to their depth.
+     */
+    bool IsBefore(int a, int b);
+
+private:
+    MultiGeneReconciler* reconciler;
+    size_t maxNbNodes;
+    uint64 nbExpanded;
+    bool fallenBack;
+
+    MultiGeneReconcilerState* state;
+    deque<AStarSearchNode> nodes;
+    priority_queue<AStarOpenEntry, vector<AStarOpenEntry>, AStarOpenEntryOrder> open;
+
+    //the path of the state received by Run, which is a prefix of the path of every node
+    vector<int> rootPath;
+
+    //the nodes from the root to the node the state is at, with the trail size and tops hash of the state
+    //before the branching of each of them was applied
+    vector<int> currentNodes;
+    vector<int> currentTrailSizes;
+    vector<uint64> currentTopsHashes;
+
+    //brings the state to the given node
+    void MoveTo(int node);
+
+    //the state being at node, creates its children and adds them to the open list
+    void Expand(int node);
+
+    //the state being at node, which is not in nodes yet, returns true iff node needs to be expanded, and its cost + lower bound in estimate.
+    //Complete mappings are given to the incumbent, and false is returned.
+    bool Evaluate(AStarSearchNode &node, double &estimate);
+
+    //returns true iff the node of entry cannot lead to a solution that replaces the incumbent.  When this is true for the
+    //first entry of the open list, it is true for all of them.
+    bool CannotImprove(const AStarOpenEntry &entry);
+
+    //returns the path of node, as in MultiGeneReconcilerState::path
+    vector<int> GetPath(int node);
+};
+
+#endif // ASTARSEARCH_H
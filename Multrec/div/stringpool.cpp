@@ -0,0 +1,91 @@
+#include "stringpool.h"
+
+#include <cstring>
+
+/**
+See stringpool.h for documentation on methods in this class.
+**/
+
+
+StringPool::StringPool()
+{
+    slots.assign(16, -1);
+}
+
+
+
+int StringPool::Intern(const string &str)
+{
+    uint64 hash = Hash(str.c_str(), str.length());
+    int slot = FindSlot(str.c_str(), str.length(), hash);
+    if (slots[slot] != -1)
+        return slots[slot];
+
+    int symbol = strings.size();
+    strings.push_back(str);
+    hashes.push_back(hash);
+    slots[slot] = symbol;
+
+    if (2 * strings.size() > slots.size())
+        Grow();
+
+    return symbol;
+}
+
+
+
+int StringPool::GetSymbol(const char* str, int length)
+{
+    return slots[FindSlot(str, length, Hash(str, length))];
+}
+
+
+
+uint64 StringPool::Hash(const char* str, int length)
+{
+    uint64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+
+int StringPool::FindSlot(const char* str, int length, uint64 hash)
+{
+    int mask = slots.size() - 1;
+    int slot = hash & mask;
+
+    //linear probing: the table is at most half full, so an empty slot is always met
+    while (slots[slot] != -1)
+    {
+        int symbol = slots[slot];
+        if (hashes[symbol] == hash && strings[symbol].length() == length &&
+                memcmp(strings[symbol].c_str(), str, length) == 0)
+            break;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+
+
+void StringPool::Grow()
+{
+    slots.assign(2 * slots.size(), -1);
+    int mask = slots.size() - 1;
+
+    for (int symbol = 0; symbol < strings.size(); symbol++)
+    {
+        int slot = hashes[symbol] & mask;
+        while (slots[slot] != -1)
+            slot = (slot + 1) & mask;
+        slots[slot] = symbol;
+    }
+}
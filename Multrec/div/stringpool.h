@@ -0,0 +1,69 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <vector>
+#include <string>
+
+#include "div/define.h"
+
+using namespace std;
+
+
+/**
+  A StringPool interns strings: each distinct string is stored once and gets a symbol, an integer from 0 to
+  GetNbSymbols() - 1 given in the order the strings are interned, so that symbols can index plain vectors.
+  Symbols are found with one probe in an open-addressing hash table, and GetSymbol can look up a substring without
+  copying it.\n
+  Interning is not thread-safe, but once the pool is filled any number of threads can look up symbols concurrently.
+  **/
+class StringPool
+{
+public:
+    StringPool();
+
+    /**
+      Returns the symbol of str, adding str to the pool if it is not there yet.
+      **/
+    int Intern(const string &str);
+
+    /**
+      Returns the symbol of the length characters starting at str, or -1 if they have not been interned.
+      **/
+    int GetSymbol(const char* str, int length);
+
+    int GetSymbol(const string &str)
+    {
+        return GetSymbol(str.c_str(), str.length());
+    }
+
+    /**
+      Returns the string of a symbol returned by Intern.
+      **/
+    const string& GetString(int symbol)
+    {
+        return strings[symbol];
+    }
+
+    int GetNbSymbols()
+    {
+        return strings.size();
+    }
+
+private:
+    //FNV-1a hash of the length characters starting at str
+    static uint64 Hash(const char* str, int length);
+
+    //returns the slot holding the string, or the empty slot where it would go
+    int FindSlot(const char* str, int length, uint64 hash);
+
+    //doubles the number of slots and puts the symbols back in
+    void Grow();
+
+    vector<string> strings;
+    vector<uint64> hashes;
+
+    //symbol stored in each slot, -1 if empty.  The number of slots is a power of 2, at least twice the number of symbols.
+    vector<int> slots;
+};
+
+#endif // STRINGPOOL_H
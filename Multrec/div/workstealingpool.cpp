@@ -0,0 +1,173 @@
+#include "workstealingpool.h"
+
+
+//pool and worker index of the current thread, if it is a worker
+static thread_local WorkStealingPool* currentPool = NULL;
+static thread_local int currentWorkerIndex = -1;
+
+
+
+WorkStealingPool::WorkStealingPool(int nbWorkers)
+{
+    if (nbWorkers < 1)
+        nbWorkers = 1;
+
+    nbQueuedTasks = 0;
+    nbPendingTasks = 0;
+    stopping = false;
+    nbIdleWorkers = 0;
+    nextQueue = 0;
+
+    queues.resize(nbWorkers);
+    for (int i = 0; i < nbWorkers; i++)
+    {
+        queueMutexes.push_back(new mutex());
+    }
+
+    for (int i = 0; i < nbWorkers; i++)
+    {
+        workers.push_back(thread(&WorkStealingPool::WorkerLoop, this, i));
+    }
+}
+
+
+WorkStealingPool::~WorkStealingPool()
+{
+    WaitAll();
+
+    {
+        unique_lock<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+
+    for (int i = 0; i < queueMutexes.size(); i++)
+    {
+        delete queueMutexes[i];
+    }
+}
+
+
+void WorkStealingPool::Submit(WorkStealingTask* task)
+{
+    int q = GetCurrentWorkerIndex();
+
+    {
+        unique_lock<mutex> lock(stateMutex);
+        if (q == -1)
+        {
+            q = nextQueue;
+            nextQueue = (nextQueue + 1) % queues.size();
+        }
+        nbQueuedTasks++;
+        nbPendingTasks++;
+    }
+
+    {
+        unique_lock<mutex> lock(*queueMutexes[q]);
+        queues[q].push_back(task);
+    }
+
+    workAvailable.notify_one();
+}
+
+
+void WorkStealingPool::WaitAll()
+{
+    unique_lock<mutex> lock(stateMutex);
+    while (nbPendingTasks > 0)
+        allDone.wait(lock);
+}
+
+
+int WorkStealingPool::GetNbWorkers()
+{
+    return workers.size();
+}
+
+
+bool WorkStealingPool::HasIdleWorkers()
+{
+    return nbIdleWorkers.load() > nbQueuedTasks.load();
+}
+
+
+int WorkStealingPool::GetCurrentWorkerIndex()
+{
+    if (currentPool == this)
+        return currentWorkerIndex;
+    return -1;
+}
+
+
+WorkStealingTask* WorkStealingPool::TakeTask(int workerIndex)
+{
+    WorkStealingTask* task = NULL;
+
+    for (int i = 0; i < queues.size() && !task; i++)
+    {
+        int q = (workerIndex + i) % queues.size();
+        unique_lock<mutex> lock(*queueMutexes[q]);
+
+        if (!queues[q].empty())
+        {
+            if (q == workerIndex)
+            {
+                task = queues[q].back();
+                queues[q].pop_back();
+            }
+            else
+            {
+                task = queues[q].front();
+                queues[q].pop_front();
+            }
+        }
+    }
+
+    if (task)
+    {
+        unique_lock<mutex> lock(stateMutex);
+        nbQueuedTasks--;
+    }
+
+    return task;
+}
+
+
+void WorkStealingPool::WorkerLoop(int workerIndex)
+{
+    currentPool = this;
+    currentWorkerIndex = workerIndex;
+
+    while (true)
+    {
+        WorkStealingTask* task = TakeTask(workerIndex);
+
+        if (task)
+        {
+            task->Run(workerIndex);
+            delete task;
+
+            unique_lock<mutex> lock(stateMutex);
+            nbPendingTasks--;
+            if (nbPendingTasks == 0)
+                allDone.notify_all();
+        }
+        else
+        {
+            unique_lock<mutex> lock(stateMutex);
+            nbIdleWorkers++;
+            while (nbQueuedTasks == 0 && !stopping)
+                workAvailable.wait(lock);
+            nbIdleWorkers--;
+
+            if (stopping && nbQueuedTasks == 0)
+                return;
+        }
+    }
+}
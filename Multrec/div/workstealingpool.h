@@ -0,0 +1,96 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+using namespace std;
+
+
+/**
+  Inheritable class for the units of work given to a WorkStealingPool.
+  **/
+class WorkStealingTask
+{
+public:
+    virtual ~WorkStealingTask() {}
+
+    /**
+      Does the work.  workerIndex is the index of the pool worker running the task, between 0 and GetNbWorkers() - 1.
+      **/
+    virtual void Run(int workerIndex) = 0;
+};
+
+
+/**
+  A fixed set of worker threads, each with its own deque of tasks.
+  A worker takes the most recent task of its own deque, and when it runs out, steals the oldest task of another worker.
+  Tasks submitted from inside a running task go to the deque of the worker running it, so that recursive
+  algorithms can hand out their subproblems while the idle workers take them.\n
+  Typical usage :
+  @code
+  WorkStealingPool pool(nbThreads);
+  pool.Submit(new MyTask(...));    //MyTask inherits WorkStealingTask
+  pool.WaitAll();
+  @endcode
+  **/
+class WorkStealingPool
+{
+public:
+    WorkStealingPool(int nbWorkers);
+
+    /**
+      Waits for all the tasks to be done, then stops the workers.
+      **/
+    ~WorkStealingPool();
+
+    /**
+      Adds a task to the pool.  The pool takes ownership of the task and deletes it once it has run.
+      **/
+    void Submit(WorkStealingTask* task);
+
+    /**
+      Blocks until every submitted task, including those submitted by other tasks, is done.
+      **/
+    void WaitAll();
+
+    int GetNbWorkers();
+
+    /**
+      True if more workers are waiting for a task than there are tasks waiting for a worker.  Tasks can use this
+      to decide whether to split their work.  This is only indicative, as it changes all the time.
+      **/
+    bool HasIdleWorkers();
+
+    /**
+      Index of the worker of this pool running the calling thread, or -1 if the caller is not one of them.
+      **/
+    int GetCurrentWorkerIndex();
+
+private:
+    vector<thread> workers;
+    vector< deque<WorkStealingTask*> > queues;
+    vector<mutex*> queueMutexes;
+
+    //protects the changes to nbQueuedTasks, nbPendingTasks, nbIdleWorkers and stopping
+    mutex stateMutex;
+    condition_variable workAvailable;
+    condition_variable allDone;
+
+    atomic<int> nbQueuedTasks;      //submitted tasks not taken yet
+    int nbPendingTasks;             //submitted tasks not finished yet
+    bool stopping;
+    atomic<int> nbIdleWorkers;
+    int nextQueue;
+
+    void WorkerLoop(int workerIndex);
+
+    //pops from the back of our own deque, or steals from the front of another.  Returns NULL if all are empty.
+    WorkStealingTask* TakeTask(int workerIndex);
+};
+
+#endif // WORKSTEALINGPOOL_H
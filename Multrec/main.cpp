@@ -1,18 +1,25 @@
 #include <iostream>
 
 #include <map>
+#include <chrono>
 #include "div/util.h"
 #include "trees/newicklex.h"
 #include "trees/node.h"
+#include "trees/nodeforest.h"
+#include "trees/flattree.h"
 #include "trees/genespeciestreeutil.h"
 #include "trees/treeiterator.h"
 #include "multigenereconciler.h"
+#include "div/tinydir.h"
 
 using namespace std;
 
 
 int verbose = 0;
 
+//minimum number of seconds between two writes of the file given by -incumbentfile
+#define INCUMBENT_FILE_INTERVAL 5
+
 
 /*
 This is a postprocessing function for outputting results.
@@ -39,8 +46,7 @@ map<Node*, vector< pair<int, Node*> > > LabelGeneTreesWithSpeciesMapping(vector<
     {
         Node* genetree = geneTrees[i];
 
-        TreeIterator* it = genetree->GetPostOrderIterator();
-        while (Node* g = it->next())
+        for (Node* g : genetree->PostOrder())
         {
             if (!g->IsLeaf())
             {
@@ -70,7 +76,6 @@ map<Node*, vector< pair<int, Node*> > > LabelGeneTreesWithSpeciesMapping(vector<
                 g->SetLabel(lbl);
             }
         }
-        genetree->CloseIterator(it);
     }
 
     return dups_per_species;
@@ -87,23 +92,21 @@ geneTrees: a vector of gene trees.
 speciesTrees: the species tree.
 species_separator: the string used to separate genes from species names in the gene labels. 
 speciesIndex: the index at which the species name resides in the gene label after being split by the separator.
+speciesNames: an index of the species names built on speciesTree, so that it is built only once.  The second version builds one.
 
 Output
 A map where the keys are the gene leaves and the values are the species the gene is mapped to.
 
 **/
-unordered_map<Node*, Node*> GetGeneSpeciesMapping(vector<Node*> geneTrees, Node* speciesTree, string species_separator, int species_index)
+unordered_map<Node*, Node*> GetGeneSpeciesMapping(vector<Node*> &geneTrees, SpeciesNameIndex* speciesNames, string species_separator, int species_index)
 {
-    //Note: could be faster by using a map for the species leaves by name...
     unordered_map<Node*, Node*> geneSpeciesMapping;
 
     for (int i = 0; i < geneTrees.size(); i++)
     {
-        unordered_map<Node*, Node*> tmpmap = GeneSpeciesTreeUtil::Instance()->GetGeneSpeciesMappingByLabel(geneTrees[i], speciesTree, species_separator, species_index);
-
-        for (unordered_map<Node*, Node*>::iterator it = tmpmap.begin(); it != tmpmap.end(); ++it)
+        for (Node* g : geneTrees[i]->PostOrder(true))
         {
-            geneSpeciesMapping[ it->first ] = it->second;
+            geneSpeciesMapping[g] = speciesNames->GetGeneSpecies(g, species_separator, species_index);
         }
     }
 
@@ -111,6 +114,14 @@ unordered_map<Node*, Node*> GetGeneSpeciesMapping(vector<Node*> geneTrees, Node*
 }
 
 
+unordered_map<Node*, Node*> GetGeneSpeciesMapping(vector<Node*> &geneTrees, Node* speciesTree, string species_separator, int species_index)
+{
+    SpeciesNameIndex speciesNames(speciesTree);
+
+    return GetGeneSpeciesMapping(geneTrees, &speciesNames, species_separator, species_index);
+}
+
+
 /**
 Prints the help.
 **/
@@ -129,6 +140,8 @@ void PrintHelp()
             <<"COST: the total cost of the mapping"<<endl
             <<"DUPHEIGHT: the sum of duplication heights"<<endl
             <<"NBLOSSES: the number of losses"<<endl
+            <<"LOWERBOUND: only with -timelimit or -nodelimit.  A lower bound on the cost of the best mapping, which is COST if the search was completed."<<endl
+            <<"GAP: only with -timelimit or -nodelimit.  (COST - LOWERBOUND) / COST, 0 if the mapping is the best one."<<endl
             <<"SPECIESTREE: the species tree newick, with internal nodes labeled by a species id given by the program."<<endl
             <<"GENETREES: all the gene tree newick, one per line. Internal nodes are labeled by the mapping and a duplication id.  For instance, an internal node labeled 14_Dup_nb2 means that the node is mapped to species 14, and it is a duplication whose id is Dup_nb2"<<endl
 			<<"DUPS_PER_SPECIES: each line contains the list of duplications mapped to each species.  For instance, the line '[2] Dup_nb2 (G4) Dup_nb5 (G5)' means that the species with id 2 has two dup nodes mapping to it: the duplication with id Dup_nb2 from the gene tree 4 (that is what the G4 is for), and the duplication with id Dup_nb4 from the gene tree 5."<<endl
@@ -140,7 +153,7 @@ void PrintHelp()
             <<"./Multrec -d 10 -l 3 -gf ./sample_data/geneTrees.txt -sf ./sample_data/speciesTree.txt"
             <<endl
             <<"Required arguments:"<<endl
-            <<"At least one of -g or -gf must be specified, and at least one of -s or -sf must be specified."<<endl
+            <<"At least one of -g, -gf or -batch must be specified, and at least one of -s or -sf must be specified."<<endl
             <<"-g   [g1;g2;...;gk]   Here g1,g2,...,gk are gene trees"<<endl
             <<"                      represented in Newick format.  "<<endl
             <<"                      The gene trees are separated by the ; symbol.	"<<endl
@@ -154,18 +167,454 @@ void PrintHelp()
             <<"--help                Print this help message."<<endl
             <<"-d   [double]         The cost for one height of duplication.  Default=3"<<endl
             <<"-l   [double]         The cost for one loss.  Default=1"<<endl
-            <<"-h   [int]            Maximum allowed duplication sum-of-heights.  Default=20"<<endl
+            <<"-dsweep [a:b:step]    Reconciles with each dup cost a, a+step, a+2*step... up to "<<endl
+            <<"                      b instead of the one of -d, reusing the work that does not "<<endl
+            <<"                      depend on it.  The output has one block per cost, which "<<endl
+            <<"                      starts with the cost between <DUPCOST> tags.  With -threads, "<<endl
+            <<"                      the costs are split among the threads.  -incumbentfile is "<<endl
+            <<"                      ignored.  Default=none"<<endl
+            <<"-batch [file|dir]     Reconciles many sets of gene trees with the species tree of "<<endl
+            <<"                      -s or -sf: the gene tree files listed in file, one per "<<endl
+            <<"                      line, or all the files of dir.  The sets are reconciled "<<endl
+            <<"                      in parallel with -threads, and their outputs come in the "<<endl
+            <<"                      order of the list, each one starting with its file name "<<endl
+            <<"                      between <INSTANCE> tags.  -g, -gf, -dsweep and "<<endl
+            <<"                      -incumbentfile are then ignored.  Default=none"<<endl
+            <<"-h   [int|auto]       Maximum allowed duplication sum-of-heights.  With auto, the "<<endl
+            <<"                      search is repeated with growing maximums, starting from a "<<endl
+            <<"                      lower bound, until no mapping with a larger sum can be "<<endl
+            <<"                      better, which gives the best mapping without any "<<endl
+            <<"                      maximum.  Default=20"<<endl
             <<"-o   [file]           Output file.  Default=output to console"<<endl
+            <<"-threads [int]        Number of threads used by the search.  The output does "<<endl
+            <<"                      not depend on it.  Default=1"<<endl
+            <<"-ttmem [int]          Memory used to remember the lower bounds computed "<<endl
+            <<"                      during the search, in MB.  Default=32"<<endl
+            <<"-search [dfs|astar]   Search strategy.  dfs explores the mappings depth-first, "<<endl
+            <<"                      astar explores the most promising ones first, which usually "<<endl
+            <<"                      explores fewer of them but uses one thread only.  Both give "<<endl
+            <<"                      the same output.  Default=dfs"<<endl
+            <<"-astarmem [int]       Memory used by -search astar, in MB.  When it runs out, the "<<endl
+            <<"                      search continues depth-first.  Default=256"<<endl
+            <<"-timelimit [double]   Stops the search after this many seconds, and outputs the "<<endl
+            <<"                      best mapping found so far, along with a LOWERBOUND on the "<<endl
+            <<"                      cost of the best mapping and the GAP between the two, "<<endl
+            <<"                      i.e. (COST - LOWERBOUND) / COST.  A GAP of 0 means that "<<endl
+            <<"                      the search was completed.  Default=no limit"<<endl
+            <<"-nodelimit [int]      Same, but stops after visiting this many nodes of the "<<endl
+            <<"                      search tree.  Default=no limit"<<endl
+            <<"-incumbentfile [file] During the search, writes the best mapping found so far to "<<endl
+            <<"                      file, in the output format, whenever it changes but at most "<<endl
+            <<"                      every 5 seconds.  Default=none"<<endl
+            <<"-v                    Prints statistics on the search to stderr."<<endl
             <<"-spsep   [string]     Gene/species separator in the gene names.  Default=__"<<endl
             <<"-spindex [int]        Position of the species in the gene names, after "<<endl
             <<"                      being split by the gene/species separator.  Default=0"<<endl
             <<"--test                Launches a series of unit tests.  This includes small fixed "<<endl
             <<"                      examples with known outputs to expect, and larger random trees "<<endl
             <<"                      to see if the program terminates in an OK status on more complicated"<<endl
-            <<"                      datasets.  "<<endl;
+            <<"                      datasets.  "<<endl
+            <<"--bench               Compares the running times of the lca implementations on "<<endl
+            <<"                      a random binary tree and on a caterpillar, and times sibling "<<endl
+            <<"                      lookups and traversals on a star with 10000 leaves."<<endl;
+}
+
+
+/**
+Builds the output of a reconciliation, in the format described in PrintHelp.  The labels of the gene trees are left as
+they were, so this can be called more than once (see WriteIncumbentFile).
+
+Parameters
+showBound: if true, the LOWERBOUND and GAP fields are added.
+
+Output
+The output, as a string.
+**/
+string GetReconciliationOutput(vector<Node*> &geneTrees, Node* speciesTree, MultiGeneReconciler &reconciler, MultiGeneReconcilerInfo &info,
+                               double dupcost, double losscost, bool showBound)
+{
+    string output = "";
+    if (info.isBad)
+    {
+        output = "NO SOLUTION FOUND";
+        if (info.isStopped)
+            output += " (STOPPED BY THE TIME OR NODE LIMIT)";
+    }
+    else
+    {
+        output += "<COST>\n" + Util::ToString(info.GetCost(dupcost, losscost)) + "\n</COST>\n";
+        output += "<DUPHEIGHT>\n" + Util::ToString(info.dupHeightSum) + "\n</DUPHEIGHT>\n";
+        output += "<NBLOSSES>\n" + Util::ToString(info.nbLosses) + "\n</NBLOSSES>\n";
+        if (showBound)
+        {
+            double cost = info.GetCost(dupcost, losscost);
+            double gap = (cost > 0 ? (cost - info.lowerBound) / cost : 0);
+            output += "<LOWERBOUND>\n" + Util::ToString(info.lowerBound) + "\n</LOWERBOUND>\n";
+            output += "<GAP>\n" + Util::ToString(gap) + "\n</GAP>\n";
+        }
+        output += "<SPECIESTREE>\n" + NewickLex::ToNewickString(speciesTree) + "\n</SPECIESTREE>\n";
+
+        //the labels are modified for the output, so we keep them to put them back afterwards
+        vector<string> labels;
+        for (int t = 0; t < geneTrees.size(); t++)
+        {
+            for (Node* g : geneTrees[t]->PostOrder())
+            {
+                labels.push_back(g->GetLabel());
+            }
+        }
+
+        map<Node*, vector< pair<int, Node*> > > dups_per_species = LabelGeneTreesWithSpeciesMapping(geneTrees, speciesTree, reconciler, info, false);
+
+        output += "<GENETREES>\n";
+        for (int t = 0; t < geneTrees.size(); t++)
+        {
+            output += NewickLex::ToNewickString(geneTrees[t]) + "\n";
+        }
+        output += "</GENETREES>\n";
+
+        output += "<DUPS_PER_SPECIES>\n";
+        for (Node* s : speciesTree->PostOrder())
+        {
+            if (dups_per_species.find(s) != dups_per_species.end())
+            {
+                output += "[" + s->GetLabel() + "] ";
+                vector< pair<int, Node*> > dups_for_s = dups_per_species[s];
+
+                for (int d = 0; d < dups_for_s.size(); d++)
+                {
+                    pair<int, Node*> p = dups_for_s[d];
+                    string lbl = p.second->GetLabel();
+                    lbl = Util::GetSubstringAfter(lbl, "_");
+
+                    output += lbl + " (G" + Util::ToString(p.first) + ") ";
+
+                }
+                output += "\n";
+            }
+        }
+        output += "</DUPS_PER_SPECIES>\n";
+
+        int l = 0;
+        for (int t = 0; t < geneTrees.size(); t++)
+        {
+            for (Node* g : geneTrees[t]->PostOrder())
+            {
+                g->SetLabel(labels[l]);
+                l++;
+            }
+        }
+    }
+
+    return output;
+}
+
+
+
+/**
+What WriteIncumbentFile needs to write the best mapping found so far to the file given by -incumbentfile.
+**/
+class IncumbentFile
+{
+public:
+    string filename;
+    vector<Node*> geneTrees;
+    Node* speciesTree;
+    MultiGeneReconciler* reconciler;
+    double dupcost;
+    double losscost;
+};
+
+
+
+/**
+Incumbent callback of the reconciler (see MultiGeneReconciler::SetIncumbentCallback).  data is an IncumbentFile.
+The output is written to a temporary file first and then renamed, so that the file is never seen half-written.
+**/
+void WriteIncumbentFile(MultiGeneReconcilerInfo &info, void* data)
+{
+    IncumbentFile* incumbentFile = (IncumbentFile*)data;
+
+    string output = GetReconciliationOutput(incumbentFile->geneTrees, incumbentFile->speciesTree, *(incumbentFile->reconciler), info,
+                                            incumbentFile->dupcost, incumbentFile->losscost, false);
+
+    string tmpname = incumbentFile->filename + ".tmp";
+    Util::WriteFileContent(tmpname, output);
+    rename(tmpname.c_str(), incumbentFile->filename.c_str());
+}
+
+
+
+/**
+Parses the argument of -dsweep, start:end:step, into the costs start, start + step, start + 2*step... up to end.
+
+Output
+The costs, or an empty vector if the argument is not valid.
+**/
+vector<double> GetSweepValues(string spec)
+{
+    vector<double> values;
+
+    vector<string> parts = Util::Split(spec, ":");
+    if (parts.size() != 3 || !Util::IsDouble(parts[0]) || !Util::IsDouble(parts[1]) || !Util::IsDouble(parts[2]))
+        return values;
+
+    double start = Util::ToDouble(parts[0]);
+    double end = Util::ToDouble(parts[1]);
+    double step = Util::ToDouble(parts[2]);
+    if (step <= 0 || end < start)
+        return values;
+
+    //each cost is computed from start, so that the rounding errors of the steps do not add up
+    int nbValues = (int)((end - start) / step + 0.000001) + 1;
+    for (int i = 0; i < nbValues; i++)
+    {
+        values.push_back(start + i * step);
+    }
+
+    return values;
+}
+
+
+
+/**
+Reconciles a contiguous range of the dup costs of -dsweep, in increasing order, with the same reconciler.  Each cost starts
+from the mapping found for the previous one (see MultiGeneReconciler::SetStartingMapping).
+**/
+class SweepTask : public WorkStealingTask
+{
+public:
+    MultiGeneReconciler* reconciler;
+    vector<double>* dupcosts;
+    double losscost;
+
+    //the range, last excluded
+    int first;
+    int last;
+
+    //one entry per cost, only those of the range are filled
+    vector<MultiGeneReconcilerInfo>* infos;
+    vector<uint64>* nbVisitedNodes;
+
+    virtual void Run(int workerIndex)
+    {
+        for (int i = first; i < last; i++)
+        {
+            reconciler->SetCosts((*dupcosts)[i], losscost);
+            (*infos)[i] = reconciler->Reconcile();
+            (*nbVisitedNodes)[i] = reconciler->GetNbVisitedNodes();
+            reconciler->SetStartingMapping((*infos)[i]);
+        }
+    }
+};
+
+
+
+/**
+Splits the content of a gene tree file, as given to -gf, into the newicks of its gene trees.
+**/
+vector<string> GetGeneTreeNewicks(string content)
+{
+    vector<string> lines = Util::Split( content, "\n");
+    vector<string> gstrs;
+    for (int l = 0; l < lines.size(); l++)
+    {
+        vector<string> trees_on_line = Util::Split( lines[l], ";", false);
+        for (int t = 0; t < trees_on_line.size(); t++)
+        {
+            if (trees_on_line[t] != "")
+                gstrs.push_back(trees_on_line[t]);
+        }
+    }
+
+    return gstrs;
+}
+
+
+
+/**
+Returns the gene tree files of -batch.  If path is a directory, these are its files sorted by name, hidden files excepted.
+Otherwise, path is a manifest with one file per line, empty lines and lines starting with # being skipped.
+**/
+vector<string> GetBatchFilenames(string path)
+{
+    vector<string> filenames;
+
+    tinydir_dir dir;
+    if (tinydir_open_sorted(&dir, path.c_str()) != -1)
+    {
+        for (int i = 0; i < dir.n_files; i++)
+        {
+            tinydir_file file;
+            tinydir_readfile_n(&dir, &file, i);
+
+            if (file.is_reg && file.name[0] != '.')
+                filenames.push_back(file.path);
+        }
+        tinydir_close(&dir);
+    }
+    else
+    {
+        vector<string> lines = Util::Split(Util::GetFileContent(path), "\n");
+        for (int l = 0; l < lines.size(); l++)
+        {
+            string line = Util::Trim(lines[l]);
+            if (line != "" && line[0] != '#')
+                filenames.push_back(line);
+        }
+    }
+
+    return filenames;
 }
 
 
+
+/**
+Writes the outputs of the instances of -batch in the order of the manifest.  The output of an instance is written as soon as
+it and all the ones before it are done, so that the instances that are done early do not wait for the whole batch.
+**/
+class BatchOutput
+{
+public:
+    BatchOutput(int nbInstances, ostream* out)
+    {
+        this->out = out;
+        this->outputs.resize(nbInstances);
+        this->stats.resize(nbInstances);
+        this->isDone.resize(nbInstances, false);
+        this->nextToWrite = 0;
+    }
+
+    //sets the output of instance i, and the statistics printed to stderr with -v, then writes whatever is next in line
+    void SetOutput(int i, string output, string instanceStats)
+    {
+        unique_lock<mutex> lock(outputMutex);
+
+        outputs[i] = output;
+        stats[i] = instanceStats;
+        isDone[i] = true;
+
+        while (nextToWrite < isDone.size() && isDone[nextToWrite])
+        {
+            (*out)<<outputs[nextToWrite]<<flush;
+            if (verbose)
+                cerr<<stats[nextToWrite];
+
+            outputs[nextToWrite] = "";
+            nextToWrite++;
+        }
+    }
+
+private:
+    ostream* out;
+    vector<string> outputs;
+    vector<string> stats;
+    vector<bool> isDone;
+    int nextToWrite;
+    mutex outputMutex;
+};
+
+
+
+/**
+What the instances of -batch share: the species tree, parsed and labeled once, the index of its species names, and the options
+of the command line.
+**/
+class BatchOptions
+{
+public:
+    Node* speciesTree;
+    SpeciesNameIndex* speciesNames;
+    string speciesSeparator;
+    int speciesIndex;
+    double dupcost;
+    double losscost;
+    int maxDupheight;
+    int ttMemory;
+    int searchMode;
+    int astarMemory;
+    double timeLimit;
+    uint64 nodeLimit;
+    bool hasLimits;
+    BatchOutput* output;
+};
+
+
+
+/**
+Reconciles one instance of -batch, i.e. the gene trees of one file with the shared species tree, and gives its output
+to the BatchOutput.  The species tree is only read, so the instances can run concurrently.
+**/
+class BatchTask : public WorkStealingTask
+{
+public:
+    BatchOptions* options;
+    int index;
+    string filename;
+
+    virtual void Run(int workerIndex)
+    {
+        string output = "<INSTANCE>\n" + filename + "\n</INSTANCE>\n";
+        string stats = "";
+        string error = "";
+
+        NodeForest geneForest;
+        vector<Node*> geneTrees;
+        vector<string> gstrs = GetGeneTreeNewicks(Util::GetFileContent(filename));
+        for (int i = 0; i < gstrs.size() && error == ""; i++)
+        {
+            Node* tree = NewickLex::ParseNewickString(gstrs[i], false, &geneForest);
+
+            if (!tree)
+                error = "Error: there is a problem with input gene tree " + gstrs[i];
+            else
+                geneTrees.push_back(tree);
+        }
+
+        if (error == "" && geneTrees.size() == 0)
+            error = "No gene tree given.";
+
+        if (error == "")
+        {
+            try
+            {
+                unordered_map<Node*, Node*> geneSpeciesMapping = GetGeneSpeciesMapping(geneTrees, options->speciesNames, options->speciesSeparator, options->speciesIndex);
+
+                MultiGeneReconciler reconciler(geneTrees, options->speciesTree, geneSpeciesMapping, options->dupcost, options->losscost, options->maxDupheight);
+                reconciler.SetTranspositionTableMemory(options->ttMemory);
+                reconciler.SetSearchMode(options->searchMode);
+                reconciler.SetAStarMemory(options->astarMemory);
+                reconciler.SetTimeLimit(options->timeLimit);
+                reconciler.SetNodeLimit(options->nodeLimit);
+
+                MultiGeneReconcilerInfo info = reconciler.Reconcile();
+
+                output += GetReconciliationOutput(geneTrees, options->speciesTree, reconciler, info, options->dupcost, options->losscost, options->hasLimits);
+                if (info.isBad)
+                    output += "\n";
+
+                stats = "Search for " + filename + ": " + to_string(reconciler.GetNbVisitedNodes()) + " nodes visited" +
+                        (info.isStopped ? ", stopped by the time or node limit" : "") + "\n";
+            }
+            catch (string &message)
+            {
+                error = message;
+            }
+            catch (const char* message)
+            {
+                error = message;
+            }
+        }
+
+        if (error != "")
+            output += error + "\n";
+
+        options->output->SetOutput(index, output, stats);
+    }
+};
+
+
+
 /**
 Executes a user command line.  This is outside the main, as the main can perform other tasks (e.g. unit testing).
 
@@ -180,6 +629,8 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
     MultiGeneReconcilerInfo info;
     info.isBad = true;
 
+    //the gene trees are allocated in the forest, which frees them when Execute returns
+    NodeForest geneForest;
     vector<Node*> geneTrees;
     Node* speciesTree = NULL;
 
@@ -188,6 +639,13 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
     double dupcost = 2;
     double losscost = 1;
     int maxDupheight = 20;
+    int nbThreads = 1;
+    int ttMemory = 32;
+    int searchMode = SEARCH_DEPTH_FIRST;
+    int astarMemory = 256;
+    double timeLimit = 0;
+    uint64 nodeLimit = 0;
+    string incumbentFilename = "";
 
     //parse dup loss cost and max dup height
     if (args.find("d") != args.end())
@@ -200,7 +658,60 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
     }
     if (args.find("h") != args.end())
     {
-        maxDupheight = Util::ToInt(args["h"]);
+        if (args["h"] == "auto")
+            maxDupheight = MAX_DUP_HEIGHT_AUTO;
+        else
+            maxDupheight = Util::ToInt(args["h"]);
+    }
+    if (args.find("threads") != args.end())
+    {
+        nbThreads = Util::ToInt(args["threads"]);
+    }
+    if (args.find("ttmem") != args.end())
+    {
+        ttMemory = Util::ToInt(args["ttmem"]);
+    }
+    if (args.find("search") != args.end())
+    {
+        if (args["search"] == "astar")
+            searchMode = SEARCH_ASTAR;
+        else if (args["search"] == "dfs")
+            searchMode = SEARCH_DEPTH_FIRST;
+        else
+        {
+            cout<<"Unknown search "<<args["search"]<<".  Program will exit."<<endl;
+            return info;
+        }
+    }
+    if (args.find("astarmem") != args.end())
+    {
+        astarMemory = Util::ToInt(args["astarmem"]);
+    }
+    if (args.find("timelimit") != args.end())
+    {
+        timeLimit = Util::ToDouble(args["timelimit"]);
+    }
+    if (args.find("nodelimit") != args.end())
+    {
+        nodeLimit = (uint64)Util::ToDouble(args["nodelimit"]);
+    }
+    if (args.find("incumbentfile") != args.end())
+    {
+        incumbentFilename = args["incumbentfile"];
+    }
+    bool hasLimits = (timeLimit > 0 || nodeLimit > 0);
+
+    //with -dsweep, dupcost is ignored and each of these costs is used in turn
+    vector<double> sweepDupcosts;
+    if (args.find("dsweep") != args.end())
+    {
+        sweepDupcosts = GetSweepValues(args["dsweep"]);
+        if (sweepDupcosts.size() == 0)
+        {
+            cout<<"Invalid -dsweep "<<args["dsweep"]<<", expected start:end:step with start <= end and step > 0.  Program will exit."<<endl;
+            return info;
+        }
+        dupcost = sweepDupcosts.back();
     }
 
     string outfile = "";
@@ -216,7 +727,7 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
         for (int i = 0; i < gstrs.size(); i++)
         {
             string str = gstrs[i];
-            Node* tree = NewickLex::ParseNewickString(str, false);
+            Node* tree = NewickLex::ParseNewickString(str, false, &geneForest);
 
             if (!tree)
             {
@@ -229,25 +740,12 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
     }
     else if (args.find("gf") != args.end())
     {
-        string gcontent = Util::GetFileContent(args["gf"]);
-
-        vector<string> lines = Util::Split( gcontent, "\n");
-        vector<string> gstrs;
-        for (int l = 0; l < lines.size(); l++)
-        {
-            vector<string> trees_on_line = Util::Split( lines[l], ";", false);
-            for (int t = 0; t < trees_on_line.size(); t++)
-            {
-                if (trees_on_line[t] != "")
-                    gstrs.push_back(trees_on_line[t]);
-            }
-        }
-
+        vector<string> gstrs = GetGeneTreeNewicks(Util::GetFileContent(args["gf"]));
 
         for (int i = 0; i < gstrs.size(); i++)
         {
             string str = gstrs[i];
-            Node* tree = NewickLex::ParseNewickString(str, false);
+            Node* tree = NewickLex::ParseNewickString(str, false, &geneForest);
 
             if (!tree)
             {
@@ -300,7 +798,14 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
 
 
 
-    if (geneTrees.size() == 0)
+    //with -batch, the gene trees are those of the instances
+    string batchPath = "";
+    if (args.find("batch") != args.end())
+    {
+        batchPath = args["batch"];
+    }
+
+    if (geneTrees.size() == 0 && batchPath == "")
     {
         cout<<"No gene tree given.  Program will exit."<<endl;
         PrintHelp();
@@ -313,7 +818,7 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
         return info;
     }
 
-    if (dupcost < 0 || losscost <= 0)
+    if (dupcost < 0 || losscost <= 0 || (sweepDupcosts.size() > 0 && sweepDupcosts[0] < 0))
     {
         cout<<"dupcost < 0 or losscost <= 0 are prohibited.  Program will exit."<<endl;
         return info;
@@ -330,81 +835,194 @@ MultiGeneReconcilerInfo Execute(map<string, string> args)
 
         GeneSpeciesTreeUtil::Instance()->LabelInternalNodesUniquely(speciesTree);
 
+        SpeciesNameIndex speciesNames(speciesTree);
+        unordered_map<Node*, Node*> geneSpeciesMapping = GetGeneSpeciesMapping(geneTrees, &speciesNames, species_separator, species_index);
 
-        unordered_map<Node*, Node*> geneSpeciesMapping = GetGeneSpeciesMapping(geneTrees, speciesTree, species_separator, species_index);
-
-        MultiGeneReconciler reconciler(geneTrees, speciesTree, geneSpeciesMapping, dupcost, losscost, maxDupheight);
+        if (batchPath != "")
+        {
+            vector<string> filenames = GetBatchFilenames(batchPath);
 
-        info = reconciler.Reconcile();
+            ofstream outstream;
+            ostream* out = &cout;
+            if (outfile != "")
+            {
+                outstream.open(outfile.c_str());
+                out = &outstream;
+            }
 
-        string output = "";
-        if (info.isBad)
-        {
-            output = "NO SOLUTION FOUND";
+            BatchOutput batchOutput(filenames.size(), out);
+
+            BatchOptions options;
+            options.speciesTree = speciesTree;
+            options.speciesNames = &speciesNames;
+            options.speciesSeparator = species_separator;
+            options.speciesIndex = species_index;
+            options.dupcost = dupcost;
+            options.losscost = losscost;
+            options.maxDupheight = maxDupheight;
+            options.ttMemory = ttMemory;
+            options.searchMode = searchMode;
+            options.astarMemory = astarMemory;
+            options.timeLimit = timeLimit;
+            options.nodeLimit = nodeLimit;
+            options.hasLimits = hasLimits;
+            options.output = &batchOutput;
+
+            //one instance per task, each on a single thread
+            WorkStealingPool pool(max(1, nbThreads));
+            for (int i = 0; i < filenames.size(); i++)
+            {
+                BatchTask* task = new BatchTask();
+                task->options = &options;
+                task->index = i;
+                task->filename = filenames[i];
+                pool.Submit(task);
+            }
+            pool.WaitAll();
         }
-        else
+        else if (sweepDupcosts.size() > 0)
         {
-            output += "<COST>\n" + Util::ToString(info.GetCost(dupcost, losscost)) + "\n</COST>\n";
-            output += "<DUPHEIGHT>\n" + Util::ToString(info.dupHeightSum) + "\n</DUPHEIGHT>\n";
-            output += "<NBLOSSES>\n" + Util::ToString(info.nbLosses) + "\n</NBLOSSES>\n";
-            output += "<SPECIESTREE>\n" + NewickLex::ToNewickString(speciesTree) + "\n</SPECIESTREE>\n";
-
-            map<Node*, vector< pair<int, Node*> > > dups_per_species = LabelGeneTreesWithSpeciesMapping(geneTrees, speciesTree, reconciler, info, false);
-
-            output += "<GENETREES>\n";
-            for (int t = 0; t < geneTrees.size(); t++)
+            //the costs are split into contiguous ranges, one per thread.  Each range has its own reconciler, which keeps what does not
+            //depend on the costs from one cost to the next.  The reconcilers are all built before any of them starts.
+            int nbRanges = max(1, min(nbThreads, (int)sweepDupcosts.size()));
+            vector<MultiGeneReconciler*> reconcilers;
+            for (int r = 0; r < nbRanges; r++)
             {
-                output += NewickLex::ToNewickString(geneTrees[t]) + "\n";
+                MultiGeneReconciler* reconciler = new MultiGeneReconciler(geneTrees, speciesTree, geneSpeciesMapping, sweepDupcosts[0], losscost, maxDupheight);
+                reconciler->SetNbThreads(max(1, nbThreads / nbRanges));
+                reconciler->SetTranspositionTableMemory(ttMemory);
+                reconciler->SetSearchMode(searchMode);
+                reconciler->SetAStarMemory(astarMemory);
+                reconciler->SetTimeLimit(timeLimit);
+                reconciler->SetNodeLimit(nodeLimit);
+                reconcilers.push_back(reconciler);
             }
-            output += "</GENETREES>\n";
 
-            output += "<DUPS_PER_SPECIES>\n";
-            TreeIterator* itsp = speciesTree->GetPostOrderIterator();
-            while (Node* s = itsp->next())
+            vector<MultiGeneReconcilerInfo> infos(sweepDupcosts.size());
+            vector<uint64> nbVisitedNodes(sweepDupcosts.size(), 0);
+            vector<int> ranges(sweepDupcosts.size(), 0);
+            WorkStealingPool pool(nbRanges);
+            for (int r = 0; r < nbRanges; r++)
             {
-                if (dups_per_species.find(s) != dups_per_species.end())
+                SweepTask* task = new SweepTask();
+                task->reconciler = reconcilers[r];
+                task->dupcosts = &sweepDupcosts;
+                task->losscost = losscost;
+                task->first = r * sweepDupcosts.size() / nbRanges;
+                task->last = (r + 1) * sweepDupcosts.size() / nbRanges;
+                task->infos = &infos;
+                task->nbVisitedNodes = &nbVisitedNodes;
+
+                for (int i = task->first; i < task->last; i++)
                 {
-                    output += "[" + s->GetLabel() + "] ";
-                    vector< pair<int, Node*> > dups_for_s = dups_per_species[s];
-
-                    for (int d = 0; d < dups_for_s.size(); d++)
-                    {
-                        pair<int, Node*> p = dups_for_s[d];
-                        string lbl = p.second->GetLabel();
-                        lbl = Util::GetSubstringAfter(lbl, "_");
+                    ranges[i] = r;
+                }
 
-                        output += lbl + " (G" + Util::ToString(p.first) + ") ";
+                pool.Submit(task);
+            }
+            pool.WaitAll();
 
-                    }
+            //one block per cost, in increasing order
+            string output = "";
+            for (int i = 0; i < sweepDupcosts.size(); i++)
+            {
+                output += "<DUPCOST>\n" + Util::ToString(sweepDupcosts[i]) + "\n</DUPCOST>\n";
+                output += GetReconciliationOutput(geneTrees, speciesTree, *reconcilers[ranges[i]], infos[i], sweepDupcosts[i], losscost, hasLimits);
+                if (infos[i].isBad)
                     output += "\n";
+
+                if (verbose)
+                {
+                    cerr<<"Search for dupcost "<<sweepDupcosts[i]<<": "<<nbVisitedNodes[i]<<" nodes visited"
+                        <<(infos[i].isStopped ? ", stopped by the time or node limit" : "")<<endl;
                 }
             }
-            speciesTree->CloseIterator(itsp);
-            output += "</DUPS_PER_SPECIES>\n";
-        }
 
-        if (outfile == "")
-            cout<<output;
-        else
-            Util::WriteFileContent(outfile, output);
+            if (outfile == "")
+                cout<<output;
+            else
+                Util::WriteFileContent(outfile, output);
 
-    }
+            info = infos.back();
 
+            for (int r = 0; r < reconcilers.size(); r++)
+            {
+                delete reconcilers[r];
+            }
+        }
+        else
+        {
+            MultiGeneReconciler reconciler(geneTrees, speciesTree, geneSpeciesMapping, dupcost, losscost, maxDupheight);
+            reconciler.SetNbThreads(nbThreads);
+            reconciler.SetTranspositionTableMemory(ttMemory);
+            reconciler.SetSearchMode(searchMode);
+            reconciler.SetAStarMemory(astarMemory);
+            reconciler.SetTimeLimit(timeLimit);
+            reconciler.SetNodeLimit(nodeLimit);
+
+            IncumbentFile incumbentFile;
+            if (incumbentFilename != "")
+            {
+                incumbentFile.filename = incumbentFilename;
+                incumbentFile.geneTrees = geneTrees;
+                incumbentFile.speciesTree = speciesTree;
+                incumbentFile.reconciler = &reconciler;
+                incumbentFile.dupcost = dupcost;
+                incumbentFile.losscost = losscost;
+                reconciler.SetIncumbentCallback(&WriteIncumbentFile, (void*)&incumbentFile, INCUMBENT_FILE_INTERVAL);
+            }
 
+            info = reconciler.Reconcile();
 
+            string output = GetReconciliationOutput(geneTrees, speciesTree, reconciler, info, dupcost, losscost, hasLimits);
 
+            if (outfile == "")
+                cout<<output;
+            else
+                Util::WriteFileContent(outfile, output);
+
+            if (verbose)
+            {
+                cerr<<"Search: "<<reconciler.GetNbVisitedNodes()<<" nodes visited"
+                    <<(info.isStopped ? ", stopped by the time or node limit" : "")<<endl;
+
+                if (maxDupheight == MAX_DUP_HEIGHT_AUTO)
+                {
+                    cerr<<"Iterative deepening: "<<reconciler.GetNbRounds()<<" rounds, up to a max dup height of "
+                        <<reconciler.GetMaxDupHeight()<<endl;
+                }
+
+                MultiGeneReconcilerKernelStats kernelStats = reconciler.GetKernelStats();
+                cerr<<"Kernel: "<<kernelStats.nbKernelNodes<<" of "<<kernelStats.nbGeneNodes<<" gene nodes searched, "
+                    <<kernelStats.nbContractedSubtrees<<" speciation subtrees contracted ("
+                    <<kernelStats.nbContractedLosses<<" losses)"<<endl;
+
+                MultiGeneReconcilerCleanupStats stats = reconciler.GetCleanupStats();
+                cerr<<"Cleanup: "<<stats.nbPasses<<" passes, "<<stats.nbExamined<<" nodes examined, "
+                    <<stats.nbSpeciations<<" speciations and "<<stats.nbEasyDuplications<<" easy duplications mapped ("
+                    <<stats.nbResolvedAtRoot<<" before the search)"<<endl;
+
+                if (searchMode == SEARCH_ASTAR)
+                {
+                    MultiGeneReconcilerAStarStats astarStats = reconciler.GetAStarStats();
+                    cerr<<"A*: "<<astarStats.nbExpanded<<" branches expanded"
+                        <<(astarStats.hasFallenBack ? ", memory limit reached, finished depth-first" : "")<<endl;
+                }
+            }
+        }
+
+    }
 
 
-    for (int i = 0; i < geneTrees.size(); i++)
-    {
-        delete geneTrees[i];
-    }
 
-    delete speciesTree;
 
 
-    return info;
-}
+
+    delete speciesTree;
+
+
+    return info;
+}
 
 
 
@@ -558,6 +1176,40 @@ void TestRandomTrees()
                 cout<<"PASSED DUPS2 TEST"<<endl;
             }
 
+            cout<<"Testing DUP2 with 4 threads"<<endl;
+
+            MultiGeneReconciler reconciler_2t(geneTrees, sptree, gsMapping, 2, 1, min(30, info.dupHeightSum));
+            reconciler_2t.SetNbThreads(4);
+            MultiGeneReconcilerInfo info_2t = reconciler_2t.Reconcile();
+
+            if (info_2t.isBad != info_2.isBad || info_2t.dupHeightSum != info_2.dupHeightSum ||
+                info_2t.nbLosses != info_2.nbLosses || info_2t.partialMapping != info_2.partialMapping)
+            {
+                cout<<"FAILED: 4 threads do not give the same mapping as 1 thread"<<endl;
+                ok = false;
+            }
+            else
+            {
+                cout<<"PASSED DUPS2 THREADS TEST"<<endl;
+            }
+
+            cout<<"Testing DUP2 with A*"<<endl;
+
+            MultiGeneReconciler reconciler_2a(geneTrees, sptree, gsMapping, 2, 1, min(30, info.dupHeightSum));
+            reconciler_2a.SetSearchMode(SEARCH_ASTAR);
+            MultiGeneReconcilerInfo info_2a = reconciler_2a.Reconcile();
+
+            if (info_2a.isBad != info_2.isBad || info_2a.dupHeightSum != info_2.dupHeightSum ||
+                info_2a.nbLosses != info_2.nbLosses || info_2a.partialMapping != info_2.partialMapping)
+            {
+                cout<<"FAILED: A* does not give the same mapping as depth-first search"<<endl;
+                ok = false;
+            }
+            else
+            {
+                cout<<"PASSED DUPS2 A* TEST"<<endl;
+            }
+
             cout<<"Testing DUP5 with maxheight="<<min(10, info.dupHeightSum)<<endl;
 
             MultiGeneReconciler reconciler_3(geneTrees, sptree, gsMapping, 5, 1, min(10, info.dupHeightSum));
@@ -588,6 +1240,686 @@ void TestRandomTrees()
 }
 
 
+/**
+Compares the lca and ancestor queries of LCAIndex with those of Node, on random trees of any degree and on a caterpillar
+much deeper than 64.
+**/
+void TestLCAIndex()
+{
+    cout<<endl<<"*** TestLCAIndex ***"<<endl;
+
+    int nbOK = 0;
+    int nbTests = 0;
+
+    for (int t = 0; t < 4; t++)
+    {
+        //trees 0-2 have random degrees, tree 3 is a caterpillar
+        Node* tree = new Node(false);
+        vector<Node*> nodes;
+        nodes.push_back(tree);
+
+        Node* spine = tree;
+        for (int i = 0; i < 300; i++)
+        {
+            if (t < 3)
+            {
+                nodes.push_back(nodes[rand() % nodes.size()]->AddChild());
+            }
+            else
+            {
+                nodes.push_back(spine->AddChild());
+                spine = spine->AddChild();
+                nodes.push_back(spine);
+            }
+        }
+
+        LCAIndex index(tree);
+
+        bool ok = true;
+        for (int i = 0; i < 2000 && ok; i++)
+        {
+            Node* n1 = nodes[rand() % nodes.size()];
+            Node* n2 = nodes[rand() % nodes.size()];
+
+            if (index.GetLCA(n1, n2) != n1->FindLCAWith(n2) || index.HasAncestor(n1, n2) != n1->HasAncestor(n2))
+                ok = false;
+            if (index.GetDepth(index.GetId(n1)) != n1->GetDepth())
+                ok = false;
+        }
+
+        nbTests++;
+        cout<<"TEST "<<t + 1<<" : "<<(t < 3 ? "random tree" : "caterpillar")<<" with "<<index.GetNbNodes()<<" nodes"<<endl;
+        if (ok)
+        {
+            nbOK++;
+            cout<<"PASSED!"<<endl;
+        }
+        else
+        {
+            cout<<"FAILED: LCAIndex does not agree with Node"<<endl;
+        }
+
+        delete tree;
+    }
+
+    //TreeInfo::GetLCA on a deep caterpillar, with nodes inserted between queries so that the index gets rebuilt
+    Node* tree = new Node(true);
+    vector<Node*> nodes;
+    nodes.push_back(tree);
+    Node* spine = tree;
+    bool ok = true;
+    for (int i = 0; i < 200 && ok; i++)
+    {
+        nodes.push_back(spine->AddChild());
+        spine = spine->AddChild();
+        nodes.push_back(spine);
+
+        for (int j = 0; j < 10 && ok; j++)
+        {
+            Node* n1 = nodes[rand() % nodes.size()];
+            Node* n2 = nodes[rand() % nodes.size()];
+
+            if (tree->GetTreeInfo()->GetLCA(n1, n2) != n1->FindLCAWith(n2))
+                ok = false;
+        }
+    }
+
+    nbTests++;
+    cout<<"TEST "<<nbTests<<" : TreeInfo on a caterpillar of height "<<spine->GetDepth()<<endl;
+    if (ok)
+    {
+        nbOK++;
+        cout<<"PASSED!"<<endl;
+    }
+    else
+    {
+        cout<<"FAILED: TreeInfo does not agree with Node"<<endl;
+    }
+    delete tree;
+
+    //GeneSpeciesTreeUtil on a non-binary species tree, built twice: without TreeInfo (lcas found by walking up, or with an
+    //explicit index), and with a TreeInfo whose index gets used by default
+    Node* speciesTree = new Node(false);
+    Node* speciesTreeTI = new Node(true);
+    vector<Node*> species(1, speciesTree);
+    vector<Node*> speciesTI(1, speciesTreeTI);
+    unordered_map<Node*, Node*> toTI;
+    toTI[speciesTree] = speciesTreeTI;
+    for (int i = 0; i < 200; i++)
+    {
+        int p = rand() % species.size();
+        species.push_back(species[p]->AddChild());
+        speciesTI.push_back(speciesTI[p]->AddChild());
+        toTI[species.back()] = speciesTI.back();
+    }
+
+    Node* geneTree = new Node(false);
+    vector<Node*> genes(1, geneTree);
+    for (int i = 0; i < 300; i++)
+    {
+        genes.push_back(genes[rand() % genes.size()]->AddChild());
+    }
+
+    unordered_map<Node*, Node*> leavesMapping;
+    unordered_map<Node*, Node*> leavesMappingTI;
+    for (int i = 0; i < genes.size(); i++)
+    {
+        if (genes[i]->IsLeaf())
+        {
+            int s = rand() % species.size();
+            while (!species[s]->IsLeaf())
+                s = rand() % species.size();
+            leavesMapping[genes[i]] = species[s];
+            leavesMappingTI[genes[i]] = speciesTI[s];
+        }
+    }
+
+    LCAIndex speciesIndex(speciesTree);
+    unordered_map<Node*, Node*> walkMapping = GeneSpeciesTreeUtil::Instance()->GetLCAMapping(geneTree, speciesTree, leavesMapping);
+    unordered_map<Node*, Node*> indexMapping = GeneSpeciesTreeUtil::Instance()->GetLCAMapping(geneTree, speciesTree, leavesMapping, &speciesIndex);
+    unordered_map<Node*, Node*> treeInfoMapping = GeneSpeciesTreeUtil::Instance()->GetLCAMapping(geneTree, speciesTreeTI, leavesMappingTI);
+
+    ok = true;
+    for (int i = 0; i < genes.size() && ok; i++)
+    {
+        Node* g = genes[i];
+        if (indexMapping[g] != walkMapping[g] || toTI[walkMapping[g]] != treeInfoMapping[g])
+            ok = false;
+        if (GeneSpeciesTreeUtil::Instance()->IsNodeDup(g, indexMapping, &speciesIndex) != GeneSpeciesTreeUtil::Instance()->IsNodeDup(g, walkMapping))
+            ok = false;
+    }
+    if (GeneSpeciesTreeUtil::Instance()->GetGeneTreeHighestSpeciations(geneTree, speciesTreeTI, treeInfoMapping) !=
+        GeneSpeciesTreeUtil::Instance()->GetGeneTreeHighestSpeciations(geneTree, speciesTree, walkMapping))
+        ok = false;
+
+    nbTests++;
+    cout<<"TEST "<<nbTests<<" : GeneSpeciesTreeUtil with and without an LCAIndex"<<endl;
+    if (ok)
+    {
+        nbOK++;
+        cout<<"PASSED!"<<endl;
+    }
+    else
+    {
+        cout<<"FAILED: lca mappings or duplications differ with the LCAIndex"<<endl;
+    }
+    delete speciesTree;
+    delete speciesTreeTI;
+    delete geneTree;
+
+    //the same random trees, allocated with new and in a NodeForest, must stay identical when parsed, copied and pruned
+    ok = true;
+    int nbForestNodes = 0;
+    {
+        NodeForest forest(64);
+        for (int t = 0; t < 20 && ok; t++)
+        {
+            Node* heapTree = new Node(false);
+            Node* forestTree = forest.CreateTree();
+            vector<Node*> heapNodes(1, heapTree);
+            vector<Node*> forestNodes(1, forestTree);
+            for (int i = 0; i < 100; i++)
+            {
+                int p = rand() % heapNodes.size();
+                heapNodes.push_back(heapNodes[p]->AddChild());
+                forestNodes.push_back(forestNodes[p]->AddChild());
+                heapNodes.back()->SetLabel(Util::ToString(i));
+                forestNodes.back()->SetLabel(Util::ToString(i));
+            }
+
+            string newick = NewickLex::ToNewickString(heapTree);
+            Node* parsedTree = NewickLex::ParseNewickString(newick, false, &forest);
+            Node* heapParsedTree = NewickLex::ParseNewickString(newick, false);
+            Node* copiedTree = forest.CreateTree();
+            copiedTree->CopyFrom(forestTree);
+
+            if (NewickLex::ToNewickString(forestTree) != newick || NewickLex::ToNewickString(copiedTree) != newick ||
+                NewickLex::ToNewickString(parsedTree) != NewickLex::ToNewickString(heapParsedTree) || parsedTree->GetForest() != &forest)
+                ok = false;
+
+            heapTree->DeleteSingleChildDescendants();
+            forestTree->DeleteSingleChildDescendants();
+            if (NewickLex::ToNewickString(forestTree) != NewickLex::ToNewickString(heapTree))
+                ok = false;
+
+            delete heapTree;
+            delete heapParsedTree;
+        }
+        nbForestNodes = forest.GetNbNodes();
+    }
+
+    nbTests++;
+    cout<<"TEST "<<nbTests<<" : trees in a NodeForest, "<<nbForestNodes<<" nodes"<<endl;
+    if (ok)
+    {
+        nbOK++;
+        cout<<"PASSED!"<<endl;
+    }
+    else
+    {
+        cout<<"FAILED: trees in the forest differ from trees allocated with new"<<endl;
+    }
+
+    //FlatTree against Node and LCAIndex on a random tree of any degree, and its lca mapping against the one of Node
+    speciesTree = new Node(false);
+    species.assign(1, speciesTree);
+    geneTree = new Node(false);
+    genes.assign(1, geneTree);
+    for (int i = 0; i < 300; i++)
+    {
+        species.push_back(species[rand() % species.size()]->AddChild());
+        genes.push_back(genes[rand() % genes.size()]->AddChild());
+    }
+    leavesMapping.clear();
+    for (int i = 0; i < genes.size(); i++)
+    {
+        if (genes[i]->IsLeaf())
+            leavesMapping[genes[i]] = species[rand() % species.size()];
+    }
+
+    LCAIndex geneIndex(geneTree);
+    LCAIndex flatSpeciesIndex(speciesTree);
+    FlatTree flatTree(geneTree);
+    flatTree.SetLeafSpecies(leavesMapping, &flatSpeciesIndex);
+    vector<int> flatMapping = GeneSpeciesTreeUtil::Instance()->GetLCAMapping(&flatTree, &flatSpeciesIndex);
+    walkMapping = GeneSpeciesTreeUtil::Instance()->GetLCAMapping(geneTree, speciesTree, leavesMapping);
+
+    ok = (flatTree.GetNbNodes() == geneIndex.GetNbNodes() && flatTree.GetNode(flatTree.GetRoot()) == geneTree);
+    for (int x = 0; x < flatTree.GetNbNodes() && ok; x++)
+    {
+        Node* n = flatTree.GetNode(x);
+        if (flatTree.GetId(n) != x || geneIndex.GetId(n) != x || flatTree.GetDepth(x) != n->GetDepth() ||
+            flatTree.GetParent(x) != geneIndex.GetParent(x) || flatSpeciesIndex.GetNode(flatMapping[x]) != walkMapping[n])
+            ok = false;
+
+        int nbChildren = 0;
+        for (int c = flatTree.GetFirstChild(x); c != -1 && ok; c = flatTree.GetNextSibling(c))
+        {
+            if (nbChildren >= n->GetNbChildren() || flatTree.GetNode(c) != n->GetChild(nbChildren))
+                ok = false;
+            nbChildren++;
+        }
+        if (nbChildren != n->GetNbChildren())
+            ok = false;
+
+        int y = rand() % flatTree.GetNbNodes();
+        if (flatTree.HasAncestor(x, y) != geneIndex.HasAncestor(x, y))
+            ok = false;
+    }
+
+    nbTests++;
+    cout<<"TEST "<<nbTests<<" : FlatTree on a random tree with "<<flatTree.GetNbNodes()<<" nodes"<<endl;
+    if (ok)
+    {
+        nbOK++;
+        cout<<"PASSED!"<<endl;
+    }
+    else
+    {
+        cout<<"FAILED: FlatTree does not agree with Node"<<endl;
+    }
+    delete speciesTree;
+    delete geneTree;
+
+    //the range-based traversals against the TreeIterators, on a single node, random trees, a subtree, and a caterpillar.  The TreeIterators go through all the nodes of the whole tree,
+    //since PreOrderTreeIterator can leave a subtree and fails at the end with leavesOnly, and the nodes to visit are kept.
+    ok = true;
+    for (int t = 0; t < 6 && ok; t++)
+    {
+        Node* tree = new Node(false);
+        Node* spine = tree;
+        vector<Node*> nodes(1, tree);
+        for (int i = 0; i < (t == 0 ? 0 : 200); i++)
+        {
+            if (t < 5)
+            {
+                nodes.push_back(nodes[rand() % nodes.size()]->AddChild());
+            }
+            else
+            {
+                nodes.push_back(spine->AddChild());
+                spine = spine->AddChild();
+                nodes.push_back(spine);
+            }
+        }
+        Node* root = (t == 4 ? nodes[1] : tree);
+
+        for (int leavesOnly = 0; leavesOnly < 2; leavesOnly++)
+        {
+            vector<Node*> expectedPostOrder;
+            TreeIterator* it = tree->GetPostOrderIterator();
+            while (Node* n = it->next())
+            {
+                if (n->HasAncestor(root) && (!leavesOnly || n->IsLeaf()))
+                    expectedPostOrder.push_back(n);
+            }
+            tree->CloseIterator(it);
+
+            vector<Node*> expectedPreOrder;
+            it = tree->GetPreOrderIterator();
+            while (Node* n = it->next())
+            {
+                if (n->HasAncestor(root) && (!leavesOnly || n->IsLeaf()))
+                    expectedPreOrder.push_back(n);
+            }
+            tree->CloseIterator(it);
+
+            vector<Node*> postOrder;
+            for (Node* n : root->PostOrder(leavesOnly))
+                postOrder.push_back(n);
+
+            vector<Node*> preOrder;
+            for (Node* n : root->PreOrder(leavesOnly))
+                preOrder.push_back(n);
+
+            if (postOrder != expectedPostOrder || preOrder != expectedPreOrder)
+                ok = false;
+        }
+
+        delete tree;
+    }
+
+    nbTests++;
+    cout<<"TEST "<<nbTests<<" : PostOrder and PreOrder traversals"<<endl;
+    if (ok)
+    {
+        nbOK++;
+        cout<<"PASSED!"<<endl;
+    }
+    else
+    {
+        cout<<"FAILED: the traversals do not agree with the TreeIterators"<<endl;
+    }
+
+    //child positions and siblings on a tree with large polytomies, after insertions, moves of subtrees, InsertParentWith
+    //and Restrict
+    ok = true;
+    Node* polytomyTree = new Node(false);
+    vector<Node*> treeNodes(1, polytomyTree);
+    for (int i = 0; i < 3000; i++)
+    {
+        Node* parent = treeNodes[rand() % min((int)treeNodes.size(), 20)];
+        int nbChildren = parent->GetNbChildren();
+        int op = (nbChildren < 2 ? 0 : rand() % 4);
+        if (op == 0)
+        {
+            treeNodes.push_back(parent->AddChild());
+        }
+        else if (op == 1)
+        {
+            treeNodes.push_back(parent->InsertChild(rand() % (nbChildren + 1)));
+        }
+        else if (op == 2)
+        {
+            Node* c1 = parent->GetChild(rand() % nbChildren);
+            Node* c2 = parent->GetChild(rand() % nbChildren);
+            if (c1 != c2)
+                treeNodes.push_back(c1->InsertParentWith(c2));
+        }
+        else
+        {
+            Node* child = parent->GetChild(rand() % nbChildren);
+            Node* target = treeNodes[rand() % treeNodes.size()];
+            if (!target->HasAncestor(child))
+            {
+                parent->RemoveChild(child);
+                target->AddSubTree(child);
+            }
+        }
+    }
+
+    for (int r = 0; r < 2 && ok; r++)
+    {
+        if (r == 1)
+        {
+            set<Node*> leavesToKeep;
+            for (Node* n : polytomyTree->PostOrder(true))
+            {
+                if (rand() % 2 == 0)
+                    leavesToKeep.insert(n);
+            }
+            Node::RestrictToLeafset(polytomyTree, leavesToKeep);
+        }
+
+        if (polytomyTree->GetChildIndex() != -1 || polytomyTree->GetRightSibling() != NULL)
+            ok = false;
+
+        for (Node* n : polytomyTree->PreOrder())
+        {
+            for (int c = 0; c < n->GetNbChildren(); c++)
+            {
+                Node* child = n->GetChild(c);
+                if (child->GetChildIndex() != c ||
+                        child->GetLeftSibling() != (c == 0 ? NULL : n->GetChild(c - 1)) ||
+                        child->GetRightSibling() != (c == n->GetNbChildren() - 1 ? NULL : n->GetChild(c + 1)))
+                    ok = false;
+            }
+        }
+    }
+    delete polytomyTree;
+
+    nbTests++;
+    cout<<"TEST "<<nbTests<<" : child positions and siblings after modifications of the tree"<<endl;
+    if (ok)
+    {
+        nbOK++;
+        cout<<"PASSED!"<<endl;
+    }
+    else
+    {
+        cout<<"FAILED: a node is not at the position it returns"<<endl;
+    }
+
+    //species names found by SpeciesNameIndex against Util::Split and GetLeafByLabel, on a species tree with more leaves than
+    //the initial size of the StringPool and a duplicated name, then on a small tree with labels that have too few fields or
+    //an unknown species
+    ok = true;
+    Node* namedSpeciesTree = new Node(false);
+    vector<Node*> speciesLeaves(1, namedSpeciesTree);
+    for (int i = 0; i < 500; i++)
+    {
+        Node* leaf = speciesLeaves[rand() % speciesLeaves.size()];
+        speciesLeaves.push_back(leaf->AddChild());
+        speciesLeaves.push_back(leaf->AddChild());
+    }
+    int nbNamed = 0;
+    for (Node* s : namedSpeciesTree->PostOrder(true))
+    {
+        s->SetLabel(nbNamed == 7 ? "SP3" : "SP" + Util::ToString(nbNamed));
+        nbNamed++;
+    }
+
+    SpeciesNameIndex speciesNames(namedSpeciesTree);
+    Node* gene = new Node(false);
+    for (int i = 0; i < 2000 && ok; i++)
+    {
+        int s = rand() % nbNamed;
+        string name = "SP" + Util::ToString(s == 7 ? 3 : s);
+        int speciesIndex = rand() % 3;
+        string lbl = "";
+        for (int f = 0; f < 4; f++)
+            lbl += (f > 0 ? "__" : "") + (f == speciesIndex ? name : "G" + Util::ToString(rand() % 100));
+        gene->SetLabel(lbl);
+
+        Node* expected = namedSpeciesTree->GetLeafByLabel(Util::Split(lbl, "__")[speciesIndex]);
+        try
+        {
+            if (speciesNames.GetGeneSpecies(gene, "__", speciesIndex) != expected || !expected)
+                ok = false;
+        }
+        catch (...)
+        {
+            ok = false;
+        }
+    }
+
+    string smallSpeciesNewick = "((SP1,SP2),SP3);";
+    Node* smallSpeciesTree = NewickLex::ParseNewickString(smallSpeciesNewick);
+    SpeciesNameIndex smallSpeciesNames(smallSpeciesTree);
+    string badLabels[] = {"SP1__G1", "G1__SP4__G2", "SP1_G1"};
+    for (int i = 0; i < 3; i++)
+    {
+        gene->SetLabel(badLabels[i]);
+        bool thrown = false;
+        try
+        {
+            smallSpeciesNames.GetGeneSpecies(gene, "__", (i == 0 ? 2 : 1));
+        }
+        catch (...)
+        {
+            thrown = true;
+        }
+        if (!thrown)
+            ok = false;
+    }
+    delete gene;
+    delete namedSpeciesTree;
+    delete smallSpeciesTree;
+
+    nbTests++;
+    cout<<"TEST "<<nbTests<<" : SpeciesNameIndex on "<<nbNamed<<" species"<<endl;
+    if (ok)
+    {
+        nbOK++;
+        cout<<"PASSED!"<<endl;
+    }
+    else
+    {
+        cout<<"FAILED: SpeciesNameIndex does not find the species of GetLeafByLabel"<<endl;
+    }
+
+    cout<<"TOTAL = "<<nbOK<<"/"<<nbTests<<endl;
+}
+
+
+
+/**
+Times nbQueries random lca queries with a given method, and returns the time per query in ns.
+The xor of the answers is returned in checksum, so that methods can be checked against each other.
+**/
+template<class F>
+double TimeLCAQueries(vector<Node*> &nodes, int nbQueries, F getLCA, uint64 &checksum)
+{
+    srand(0);
+    checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < nbQueries; i++)
+    {
+        Node* n1 = nodes[rand() % nodes.size()];
+        Node* n2 = nodes[rand() % nodes.size()];
+        checksum ^= (uint64)getLCA(n1, n2);
+    }
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / nbQueries;
+}
+
+
+/**
+Compares the running times of the lca implementations: TreeInfo::GetLCA (LCAIndex), TreeInfo::GetLCAWithPathBits
+and Node::FindLCAWith.  Path bits are only timed on a random binary tree of height < 64, since they cannot handle
+the caterpillar, and FindLCAWith is given fewer queries on the caterpillar since it takes time linear in the height.
+**/
+void RunBenchmark()
+{
+    cout<<endl<<"*** LCA benchmark ***"<<endl;
+
+    int nbLeaves = 2000;
+    int nbQueries = 1000000;
+
+    for (int t = 0; t < 2; t++)
+    {
+        //tree 0 is built by splitting random leaves, tree 1 is a caterpillar
+        Node* tree;
+        vector<Node*> nodes;
+        int height = 0;
+        do
+        {
+            tree = new Node(true);
+            nodes.clear();
+            nodes.push_back(tree);
+            vector<Node*> leaves;
+            leaves.push_back(tree);
+
+            for (int i = 1; i < nbLeaves; i++)
+            {
+                int index = (t == 0 ? rand() % leaves.size() : leaves.size() - 1);
+                Node* leaf = leaves[index];
+                leaves[index] = leaf->AddChild();
+                leaves.push_back(leaf->AddChild());
+                nodes.push_back(leaves[index]);
+                nodes.push_back(leaves.back());
+            }
+
+            height = 0;
+            for (int i = 0; i < nodes.size(); i++)
+                height = max(height, nodes[i]->GetDepth());
+
+            if (t == 0 && height >= 64)
+                delete tree;
+        }
+        while (t == 0 && height >= 64);
+
+        TreeInfo* treeInfo = tree->GetTreeInfo();
+        int nbNaiveQueries = (t == 0 ? nbQueries : nbQueries / 100);
+        cout<<(t == 0 ? "Random binary tree" : "Caterpillar")<<" with "<<nodes.size()<<" nodes, height "<<height<<endl;
+
+        uint64 indexChecksum, checksum;
+
+        auto start = chrono::steady_clock::now();
+        treeInfo->GetLCAIndex();
+        double buildTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        double indexTime = TimeLCAQueries(nodes, nbQueries, [&](Node* n1, Node* n2){ return treeInfo->GetLCA(n1, n2); }, indexChecksum);
+        cout<<"  LCAIndex:    "<<indexTime<<" ns/query over "<<nbQueries<<" queries, "<<buildTime<<" ms to build the index"<<endl;
+
+        if (t == 0)
+        {
+            start = chrono::steady_clock::now();
+            treeInfo->ParseTree(NULL, false, true, true);
+            buildTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            double pathBitsTime = TimeLCAQueries(nodes, nbQueries, [&](Node* n1, Node* n2){ return treeInfo->GetLCAWithPathBits(n1, n2); }, checksum);
+            cout<<"  Path bits:   "<<pathBitsTime<<" ns/query over "<<nbQueries<<" queries, "<<buildTime<<" ms to compute the path bits"
+                <<(checksum == indexChecksum ? "" : "  (ANSWERS DIFFER FROM LCAIndex)")<<endl;
+        }
+        else
+        {
+            cout<<"  Path bits:   not applicable (height >= 64)"<<endl;
+        }
+
+        double naiveTime = TimeLCAQueries(nodes, nbNaiveQueries, [&](Node* n1, Node* n2){ return n1->FindLCAWith(n2); }, checksum);
+        cout<<"  FindLCAWith: "<<naiveTime<<" ns/query over "<<nbNaiveQueries<<" queries"<<endl;
+
+        delete tree;
+    }
+}
+
+
+/**
+Times the operations that look for the siblings of a node on a star with nbLeaves leaves: walking through the children
+with GetRightSibling, traversing with the TreeIterators and with PostOrder, parsing the star and binarizing it.
+**/
+void RunPolytomyBenchmark()
+{
+    cout<<endl<<"*** Polytomy benchmark ***"<<endl;
+
+    int nbLeaves = 10000;
+
+    auto start = chrono::steady_clock::now();
+    Node* star = new Node(false);
+    for (int i = 0; i < nbLeaves; i++)
+    {
+        star->AddChild()->SetLabel("L" + Util::ToString(i));
+    }
+    double buildTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout<<"Star with "<<nbLeaves<<" leaves"<<endl;
+    cout<<"  Build:               "<<buildTime<<" ms"<<endl;
+
+    start = chrono::steady_clock::now();
+    int nbSiblings = 0;
+    for (Node* n = star->GetChild(0); n; n = n->GetRightSibling())
+        nbSiblings++;
+    cout<<"  GetRightSibling:     "<<chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+        <<" ms to walk through "<<nbSiblings<<" children"<<endl;
+
+    start = chrono::steady_clock::now();
+    int nbNodes = 0;
+    TreeIterator* it = star->GetPostOrderIterator();
+    while (it->next())
+        nbNodes++;
+    star->CloseIterator(it);
+    cout<<"  Post-order iterator: "<<chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+        <<" ms for "<<nbNodes<<" nodes"<<endl;
+
+    start = chrono::steady_clock::now();
+    nbNodes = 0;
+    it = star->GetPreOrderIterator();
+    while (it->next())
+        nbNodes++;
+    star->CloseIterator(it);
+    cout<<"  Pre-order iterator:  "<<chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+        <<" ms for "<<nbNodes<<" nodes"<<endl;
+
+    start = chrono::steady_clock::now();
+    nbNodes = 0;
+    for (Node* n : star->PostOrder())
+        nbNodes++;
+    cout<<"  PostOrder:           "<<chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+        <<" ms for "<<nbNodes<<" nodes"<<endl;
+
+    string newick = NewickLex::ToNewickString(star);
+    start = chrono::steady_clock::now();
+    Node* parsed = NewickLex::ParseNewickString(newick);
+    cout<<"  ParseNewickString:   "<<chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+        <<" ms for "<<parsed->GetNbChildren()<<" children"<<endl;
+    delete parsed;
+
+    start = chrono::steady_clock::now();
+    star->BinarizeRandomly();
+    cout<<"  BinarizeRandomly:    "<<chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+        <<" ms"<<endl;
+
+    delete star;
+}
+
+
 /**
 Performs some unit tests on known instances and outputs results on stdout.
 **/
@@ -630,8 +1962,104 @@ void TestBasicInstance()
     ok = RunTest(geneTrees, speciesTree, gsMapping, 2.0001, 1, 2, 1, 7, false);
     if (ok){ nbOK++;  cout<<"PASSED!"<<endl; }
 
+    //which minimal node gets branched on changes the mapping found, so this checks the branching order
+    cout<<"TEST 4: delta = 3, max height 8, 4 gene trees (branching order)"<<endl;
+    string newicks4[] = {"(((S4__0_6,(S4__0_2,S1__0_1)),S5__0_4),((S5__0_5,S5__0_7),(S3__0_3,S6__0_0)));",
+                         "(((S1__1_4,S1__1_5),S7__1_3),(S3__1_0,(S6__1_2,S6__1_1)));",
+                         "((S4__2_2,(S7__2_0,S1__2_3)),(S1__2_4,S4__2_1));",
+                         "((S2__3_2,S7__3_1),S6__3_0);"};
+    vector<Node*> geneTrees4;
+    for (int i = 0; i < 4; i++)
+    {
+        geneTrees4.push_back( NewickLex::ParseNewickString( newicks4[i] ) );
+    }
+    string snewick4 = "((S0,((S6,S2),(S4,(S7,(S1,S5))))),S3);";
+    Node* speciesTree4 = NewickLex::ParseNewickString(snewick4);
+    GeneSpeciesTreeUtil::Instance()->LabelInternalNodesUniquely(speciesTree4);
+    unordered_map<Node*, Node*> gsMapping4 = GetGeneSpeciesMapping(geneTrees4, speciesTree4, "__", 0);
+    nbTests++;
+    ok = RunTest(geneTrees4, speciesTree4, gsMapping4, 3, 1, 8, 5, 39, false);
+    if (ok){ nbOK++;  cout<<"PASSED!"<<endl; }
+
+    //the best cost is 5 * 3 + 39 = 54, which must lie between the lower bound and the cost of a stopped search
+    cout<<"TEST 5: same, with node limits"<<endl;
+    nbTests++;
+    ok = true;
+    uint64 nodeLimits[] = {1, 10, 100, 1000000000};
+    for (int i = 0; i < 4; i++)
+    {
+        MultiGeneReconciler reconciler(geneTrees4, speciesTree4, gsMapping4, 3, 1, 8);
+        reconciler.SetNodeLimit(nodeLimits[i]);
+        MultiGeneReconcilerInfo info = reconciler.Reconcile();
+
+        if (info.lowerBound > 54 || (!info.isBad && info.GetCost(3, 1) < 54))
+        {
+            ok = false;
+            cout<<"FAILED: with node limit "<<nodeLimits[i]<<", lower bound "<<info.lowerBound<<" and cost "<<info.GetCost(3, 1)<<endl;
+        }
+        if (i == 3 && (info.isStopped || info.lowerBound != 54 || info.GetCost(3, 1) != 54))
+        {
+            ok = false;
+            cout<<"FAILED: the search should have completed"<<endl;
+        }
+    }
+    if (ok){ nbOK++;  cout<<"PASSED!"<<endl; }
+
+    //no mapping has a dup height sum above the number of internal nodes, so 30 never prunes anything here
+    cout<<"TEST 6: same, with an automatic max height (iterative deepening)"<<endl;
+    nbTests++;
+    ok = true;
+    {
+        MultiGeneReconciler autoReconciler(geneTrees4, speciesTree4, gsMapping4, 3, 1, MAX_DUP_HEIGHT_AUTO);
+        MultiGeneReconcilerInfo autoInfo = autoReconciler.Reconcile();
+        MultiGeneReconciler fullReconciler(geneTrees4, speciesTree4, gsMapping4, 3, 1, 30);
+        MultiGeneReconcilerInfo fullInfo = fullReconciler.Reconcile();
+
+        if (autoInfo.isBad || autoInfo.idMapping != fullInfo.idMapping || autoInfo.lowerBound != autoInfo.GetCost(3, 1))
+        {
+            ok = false;
+            cout<<"FAILED: the mapping should be the one found with a max height of 30"<<endl;
+        }
+        if (autoReconciler.GetNbRounds() < 2)
+        {
+            ok = false;
+            cout<<"FAILED: "<<autoReconciler.GetNbRounds()<<" round(s), more expected"<<endl;
+        }
+    }
+    if (ok){ nbOK++;  cout<<"PASSED!"<<endl; }
+
+    //as done by -dsweep, each cost starts from the mapping of the previous one
+    cout<<"TEST 7: same, with dup costs 1 to 5 on the same reconciler"<<endl;
+    nbTests++;
+    ok = true;
+    {
+        MultiGeneReconciler sweepReconciler(geneTrees4, speciesTree4, gsMapping4, 1, 1, 8);
+        for (int d = 1; d <= 5; d++)
+        {
+            sweepReconciler.SetCosts(d, 1);
+            MultiGeneReconcilerInfo sweepInfo = sweepReconciler.Reconcile();
+            sweepReconciler.SetStartingMapping(sweepInfo);
+
+            MultiGeneReconciler singleReconciler(geneTrees4, speciesTree4, gsMapping4, d, 1, 8);
+            MultiGeneReconcilerInfo singleInfo = singleReconciler.Reconcile();
+
+            if (sweepInfo.isBad || sweepInfo.idMapping != singleInfo.idMapping)
+            {
+                ok = false;
+                cout<<"FAILED: with dup cost "<<d<<", the mapping should be the one found by a new reconciler"<<endl;
+            }
+        }
+    }
+    if (ok){ nbOK++;  cout<<"PASSED!"<<endl; }
+
     cout<<"TOTAL = "<<nbOK<<"/"<<nbTests<<endl;
 
+    for (int i = 0; i < geneTrees4.size(); i++)
+    {
+        delete geneTrees4[i];
+    }
+    delete speciesTree4;
+
     for (int i = 0; i < geneTrees.size(); i++)
     {
         delete geneTrees[i];
@@ -780,6 +2208,7 @@ int main(int argc, char *argv[])
 
     bool hasHelp = false;
     bool hasTest = false;
+    bool hasBench = false;
 
     //BUILD DICTIONARY OF ARGS
     string prevArg = "";
@@ -798,6 +2227,10 @@ int main(int argc, char *argv[])
         {
             hasTest = true;
         }
+        else if (string(argv[i]) == "--bench")
+        {
+            hasBench = true;
+        }
         else
         {
             if (prevArg != "" && prevArg[0] == '-')
@@ -816,6 +2249,14 @@ int main(int argc, char *argv[])
         TestBasicInstance();
         TestCaterpillarSpeciesTree();
         TestRandomTrees();
+        TestLCAIndex();
+
+        return 0;
+    }
+    else if (hasBench)
+    {
+        RunBenchmark();
+        RunPolytomyBenchmark();
 
         return 0;
     }
@@ -1,166 +1,750 @@
 #include "multigenereconciler.h"
+#include "reconcilerlowerbounds.h"
+#include "astarsearch.h"
 
 /**
 See multigenereconciler.h for documentation on methods in this class.
 **/
 
 
+/**
+  A subtree of the search, to be explored by a worker of the pool during a parallel Reconcile.
+  It has its own copy of the state, so it does not interfere with the task that created it.
+  **/
+class MultiGeneReconcilerTask : public WorkStealingTask
+{
+public:
+    MultiGeneReconcilerTask(MultiGeneReconciler* reconciler, MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info)
+        : state(state), info(info)
+    {
+        this->reconciler = reconciler;
+    }
+
+    virtual void Run(int workerIndex)
+    {
+        reconciler->ReconcileRecursive(state, info);
+    }
+
+private:
+    MultiGeneReconciler* reconciler;
+    MultiGeneReconcilerState state;
+    MultiGeneReconcilerInfo info;
+};
+
+
+
 MultiGeneReconciler::MultiGeneReconciler(vector<Node *> &geneTrees, Node *speciesTree, unordered_map<Node *, Node *> &geneSpeciesMapping, double dupcost, double losscost, int maxDupHeight)
 {
     this->geneTrees = geneTrees;
     this->speciesTree = speciesTree;
-    this->geneSpeciesMapping = geneSpeciesMapping;
     this->dupcost = dupcost;
     this->losscost = losscost;
     this->maxDupHeight = maxDupHeight;
+    this->isAutoMaxDupHeight = (maxDupHeight == MAX_DUP_HEIGHT_AUTO);
+    this->nbRounds = 0;
+    this->hasRootState = false;
+    this->rootLosses = 0;
+    this->startingMapping.isBad = true;
+    this->prunedLowerBound = numeric_limits<double>::infinity();
+    this->prunedDupHeight = numeric_limits<int>::max();
+    this->nbThreads = 1;
+    this->searchMode = SEARCH_DEPTH_FIRST;
+    this->astarMemory = 256;
+    this->pool = NULL;
+    this->transpositionTableMemory = 32;
+    this->incumbentCost = numeric_limits<double>::infinity();
+    this->timeLimit = 0;
+    this->nodeLimit = 0;
+    this->nbVisitedNodes = 0;
+    this->stopped = false;
+    this->incumbentCallback = NULL;
+    this->incumbentCallbackData = NULL;
+    this->incumbentCallbackInterval = 0;
+
+    ComputeNodeIds(geneSpeciesMapping);
+
+    AddLowerBound(new ForcedLossesLowerBound());
+    AddLowerBound(new ForcedDuplicationsLowerBound());
 }
 
 
 
-MultiGeneReconcilerInfo MultiGeneReconciler::Reconcile()
+MultiGeneReconciler::~MultiGeneReconciler()
 {
-    ComputeLCAMapping();
+    ClearLowerBounds();
+    delete speciesIndex;
+}
 
-    unordered_map<Node*, Node*> partialMapping(this->geneSpeciesMapping);
 
 
-    unordered_map<Node*, int> duplicationHeights;
-    TreeIterator* it = speciesTree->GetPostOrderIterator();
-    while (Node* s = it->next())
+MultiGeneReconcilerInfo MultiGeneReconciler::Reconcile()
+{
+    startTime = chrono::steady_clock::now();
+    nbVisitedNodes = 0;
+    stopped = false;
+    abandonedLowerBound = numeric_limits<double>::infinity();
+    incumbentVersion = 0;
+    reportedVersion = 0;
+    lastReportTime = startTime - chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(incumbentCallbackInterval));
+
+    cleanupStats.assign(max(1, nbThreads), MultiGeneReconcilerCleanupStats());
+    astarStats = MultiGeneReconcilerAStarStats();
+
+    //the clean state before the search does not depend on the costs (see SetCosts)
+    if (!hasRootState)
     {
-        duplicationHeights[s] = 0;
+        ComputeRootState();
+        hasRootState = true;
     }
-    speciesTree->CloseIterator(it);
-
-    vector<Node*> minimalNodes = GetMinimalUnmappedNodes(partialMapping);
-    int added_losses = CleanupPartialMapping(partialMapping, duplicationHeights, minimalNodes);
+    MultiGeneReconcilerState state = rootState;
+    cleanupStats[0] = rootCleanupStats;
 
 
+    currentBestInfo = MultiGeneReconcilerInfo();
     currentBestInfo.dupHeightSum = 999999;
     currentBestInfo.nbLosses = 999999;
     currentBestInfo.isBad = true;
+    currentBestPath.clear();
+    incumbentCost = numeric_limits<double>::infinity();
 
     MultiGeneReconcilerInfo info;
     info.dupHeightSum = 0;
-    info.nbLosses = added_losses;
-    info.partialMapping = partialMapping;
+    info.nbLosses = rootLosses;
+
+    //the A* search runs on one thread
+    int nbTables = (searchMode == SEARCH_ASTAR ? 1 : max(1, nbThreads));
+    for (int i = 0; i < nbTables; i++)
+    {
+        transpositionTables.push_back(new TranspositionTable((size_t)transpositionTableMemory * 1024 * 1024 / nbTables));
+    }
+    boundScratches.assign(nbTables, vector<int>(geneNodes.size(), -1));
+
+    //no mapping has fewer dup heights than the bound on the whole state, so the rounds start there
+    if (isAutoMaxDupHeight)
+    {
+        int nbDups = 0;
+        int nbLosses = 0;
+        if (state.frontierSize > 0)
+            GetLowerBound(state, nbDups, nbLosses);
+        maxDupHeight = nbDups;
+    }
 
-    MultiGeneReconcilerInfo retinfo = ReconcileRecursive(info, duplicationHeights);
+    int step = 1;
+    //with MAX_DUP_HEIGHT_AUTO, the seed does not depend on the round, and the incumbent of a round is still valid in the next one
+    SeedIncumbent(state, info);
+
+    //see SetStartingMapping.  Like the seed, it has no path.
+    if (!startingMapping.isBad && (isAutoMaxDupHeight || startingMapping.dupHeightSum <= maxDupHeight) &&
+        startingMapping.GetCost(dupcost, losscost) < incumbentCost.load())
+    {
+        currentBestInfo = startingMapping;
+        currentBestPath = vector<int>(1, numeric_limits<int>::max());
+        incumbentCost = startingMapping.GetCost(dupcost, losscost);
+    }
+
+    nbRounds = 0;
+    while (true)
+    {
+        nbRounds++;
+        prunedLowerBound = numeric_limits<double>::infinity();
+        prunedDupHeight = numeric_limits<int>::max();
+
+        SearchRound(state, info);
+
+        //the mappings over maxDupHeight that could still beat the incumbent are all under the pruned branches.  A tie may come
+        //before the incumbent in the search order, so it takes a strictly smaller cost to stop.
+        if (!isAutoMaxDupHeight || stopped || prunedLowerBound.load() == numeric_limits<double>::infinity() ||
+            incumbentCost.load() < prunedLowerBound.load())
+        {
+            break;
+        }
+
+        //there is nothing new to find below the smallest dup height of the pruned branches.  Growing steps keep the total work
+        //of the rounds within a small factor of the last one.
+        maxDupHeight = max(prunedDupHeight.load(), maxDupHeight + step);
+        step *= 2;
+    }
+
+    for (int i = 0; i < transpositionTables.size(); i++)
+    {
+        delete transpositionTables[i];
+    }
+    transpositionTables.clear();
+    boundScratches.clear();
+
+    ReportIncumbent(true);
+
+    MultiGeneReconcilerInfo retinfo = currentBestInfo;
+    if (!retinfo.isBad)
+        retinfo.partialMapping = GetNodeMapping(retinfo.idMapping);
+
+    //every mapping is either found, pruned, or under an abandoned branch
+    retinfo.isStopped = stopped;
+    retinfo.lowerBound = min(incumbentCost.load(), abandonedLowerBound);
+    if (isAutoMaxDupHeight)
+        retinfo.lowerBound = min(retinfo.lowerBound, prunedLowerBound.load());
 
     return retinfo;
 }
 
 
 
-MultiGeneReconcilerInfo MultiGeneReconciler::ReconcileRecursive(MultiGeneReconcilerInfo &info, unordered_map<Node*, int> &duplicationHeights)
+void MultiGeneReconciler::ComputeRootState()
 {
-    //IMPORTANT ASSERTION: partialMapping is clean
+    //only the leaves are mapped at first
+    rootState = MultiGeneReconcilerState();
+    rootState.partialMapping.resize(geneNodes.size(), -1);
+    for (int g = 0; g < geneNodes.size(); g++)
+    {
+        if (geneChildren0[g] == -1)
+        {
+            rootState.partialMapping[g] = lcaMapping[g];
 
-    //ASSERTION 2 : dupheights is smaller than maxDupheight
-    if (info.dupHeightSum > maxDupHeight)
+            if (geneParents[g] != -1)
+                rootState.topsHash ^= GetTopHash(g, lcaMapping[g]);
+        }
+        else
+        {
+            rootState.nbUnmapped++;
+        }
+    }
+
+    rootState.duplicationHeights.resize(speciesIndex->GetNbNodes(), 0);
+    rootState.chainHeights.resize(geneNodes.size(), 0);
+    rootState.inWorklist.resize(geneNodes.size(), 0);
+
+    rootState.frontier.resize(geneNodes.size(), -1);
+    rootState.frontierPositions.resize(geneNodes.size(), -1);
+    vector<int> minimalNodes = GetMinimalUnmappedNodes(rootState.partialMapping);
+    for (int i = 0; i < minimalNodes.size(); i++)
     {
-        MultiGeneReconcilerInfo retinfo;
-        retinfo.isBad = true;
-        return retinfo;
+        rootState.AddToFrontier(minimalNodes[i]);
     }
 
-    //this makes this more of a branch-and-bound algorithm now...
-    if (!currentBestInfo.isBad && currentBestInfo.GetCost(dupcost, losscost) < info.GetCost(dupcost, losscost))
+    rootLosses = contractedLosses + CleanupPartialMapping(rootState, minimalNodes);
+    rootCleanupStats = cleanupStats[0];
+    rootCleanupStats.nbResolvedAtRoot = rootCleanupStats.nbSpeciations + rootCleanupStats.nbEasyDuplications;
+}
+
+
+
+int MultiGeneReconciler::GetMaxDupHeight()
+{
+    return maxDupHeight;
+}
+
+
+
+int MultiGeneReconciler::GetNbRounds()
+{
+    return nbRounds;
+}
+
+
+
+void MultiGeneReconciler::SearchRound(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info)
+{
+    if (searchMode == SEARCH_ASTAR)
+    {
+        AStarSearch search(this, (size_t)astarMemory * 1024 * 1024);
+        search.Run(state, info);
+        astarStats.nbExpanded += search.GetNbExpanded();
+        astarStats.hasFallenBack = astarStats.hasFallenBack || search.HasFallenBack();
+    }
+    else if (nbThreads > 1)
+    {
+        pool = new WorkStealingPool(nbThreads);
+        pool->Submit(new MultiGeneReconcilerTask(this, state, info));
+        pool->WaitAll();
+        delete pool;
+        pool = NULL;
+    }
+    else
+    {
+        ReconcileRecursive(state, info);
+    }
+}
+
+
+
+void MultiGeneReconciler::SetCosts(double dupcost, double losscost)
+{
+    this->dupcost = dupcost;
+    this->losscost = losscost;
+}
+
+
+
+void MultiGeneReconciler::SetStartingMapping(MultiGeneReconcilerInfo &info)
+{
+    startingMapping = info;
+    startingMapping.partialMapping.clear();
+}
+
+
+
+void MultiGeneReconciler::SetNbThreads(int nbThreads)
+{
+    this->nbThreads = nbThreads;
+}
+
+
+
+void MultiGeneReconciler::SetSearchMode(int searchMode)
+{
+    this->searchMode = searchMode;
+}
+
+
+
+void MultiGeneReconciler::SetAStarMemory(int megabytes)
+{
+    this->astarMemory = megabytes;
+}
+
+
+
+void MultiGeneReconciler::SetTimeLimit(double seconds)
+{
+    this->timeLimit = seconds;
+}
+
+
+
+void MultiGeneReconciler::SetNodeLimit(uint64 nbNodes)
+{
+    this->nodeLimit = nbNodes;
+}
+
+
+
+void MultiGeneReconciler::SetIncumbentCallback(void (*callback)(MultiGeneReconcilerInfo &info, void* data), void* data, double interval)
+{
+    this->incumbentCallback = callback;
+    this->incumbentCallbackData = data;
+    this->incumbentCallbackInterval = interval;
+}
+
+
+
+uint64 MultiGeneReconciler::GetNbVisitedNodes()
+{
+    return nbVisitedNodes.load();
+}
+
+
+
+MultiGeneReconcilerCleanupStats MultiGeneReconciler::GetCleanupStats()
+{
+    MultiGeneReconcilerCleanupStats total;
+    for (int i = 0; i < cleanupStats.size(); i++)
     {
-        info.isBad = true;
-        return info;
+        total.nbPasses += cleanupStats[i].nbPasses;
+        total.nbExamined += cleanupStats[i].nbExamined;
+        total.nbSpeciations += cleanupStats[i].nbSpeciations;
+        total.nbEasyDuplications += cleanupStats[i].nbEasyDuplications;
+        total.nbResolvedAtRoot += cleanupStats[i].nbResolvedAtRoot;
     }
 
+    return total;
+}
+
+
+
+MultiGeneReconcilerAStarStats MultiGeneReconciler::GetAStarStats()
+{
+    return astarStats;
+}
+
+
+
+MultiGeneReconcilerKernelStats MultiGeneReconciler::GetKernelStats()
+{
+    return kernelStats;
+}
 
-    //TODO: we could be more clever and avoid recomputing this at every recursion
-    unordered_map<Node*, Node*> partialMapping = info.partialMapping;
-    vector<Node*> minimalNodes = GetMinimalUnmappedNodes(partialMapping);
 
-    if (minimalNodes.size() == 0) //normally, this means the mapping is complete
+
+void MultiGeneReconciler::AddLowerBound(MultiGeneReconcilerLowerBound* lowerBound)
+{
+    lowerBounds.push_back(lowerBound);
+}
+
+
+
+void MultiGeneReconciler::ClearLowerBounds()
+{
+    for (int i = 0; i < lowerBounds.size(); i++)
     {
+        delete lowerBounds[i];
+    }
+    lowerBounds.clear();
+}
+
+
+
+void MultiGeneReconciler::SetTranspositionTableMemory(int megabytes)
+{
+    this->transpositionTableMemory = megabytes;
+}
 
-        if (currentBestInfo.isBad || info.GetCost(dupcost, losscost) < currentBestInfo.GetCost(dupcost, losscost))
-            currentBestInfo = info;
 
-        return info;
+
+uint64 MultiGeneReconciler::GetTopHash(int g, int s)
+{
+    //splitmix64 on the pair, which gives independent looking values for all pairs without having to store them
+    uint64 z = (uint64)g * (uint64)speciesIndex->GetNbNodes() + (uint64)s + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+
+void MultiGeneReconciler::GetLowerBound(MultiGeneReconcilerState &state, int &nbDups, int &nbLosses)
+{
+    int workerIndex = (pool ? pool->GetCurrentWorkerIndex() : 0);
+    TranspositionTable* table = transpositionTables[workerIndex];
+
+    if (table->Get(state.topsHash, nbDups, nbLosses))
+        return;
+
+    nbDups = 0;
+    nbLosses = 0;
+
+    //each bound underestimates both quantities, so we can take the best of each separately
+    for (int i = 0; i < lowerBounds.size(); i++)
+    {
+        int d = 0;
+        int l = 0;
+        lowerBounds[i]->GetLowerBound(this, state, d, l);
+
+        nbDups = max(nbDups, d);
+        nbLosses = max(nbLosses, l);
     }
-    else
+
+    //the more nodes are unmapped, the longer it takes to compute the bounds
+    table->Put(state.topsHash, nbDups, nbLosses, state.nbUnmapped);
+}
+
+
+
+void MultiGeneReconciler::UpdateIncumbent(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info)
+{
+    double cost = info.GetCost(dupcost, losscost);
+
+    //no need to lock if we can't even tie
+    if (cost > incumbentCost.load(memory_order_relaxed))
+        return;
+
+    unique_lock<mutex> lock(incumbentMutex);
+
+    double bestCost = incumbentCost.load(memory_order_relaxed);
+
+    if (cost < bestCost || (cost == bestCost && state.path < currentBestPath))
     {
-        Node* lowest = GetLowestMinimalNode(minimalNodes, partialMapping);
+        currentBestInfo = info;
+        currentBestInfo.idMapping = state.partialMapping;
+        currentBestPath = state.path;
+        incumbentCost.store(cost, memory_order_relaxed);
+        incumbentVersion++;
+    }
+}
 
-        vector<Node*> sps = GetPossibleSpeciesMapping(lowest, partialMapping);
 
-        //we'll try mapping lowest to every possible species, and keep the best
-        MultiGeneReconcilerInfo bestInfo;
-        bestInfo.nbLosses = 999999;
-        bestInfo.dupHeightSum = 999999;
-        bestInfo.isBad = true;
 
-        for (int i = 0; i < sps.size(); i++)
+bool MultiGeneReconciler::VisitNode()
+{
+    uint64 nb = nbVisitedNodes.fetch_add(1, memory_order_relaxed) + 1;
+
+    if (nodeLimit > 0 && nb > nodeLimit)
+        stopped.store(true, memory_order_relaxed);
+
+    if (nb % 64 == 0 && (timeLimit > 0 || incumbentCallback))
+    {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+        if (timeLimit > 0 && elapsed.count() >= timeLimit)
+            stopped.store(true, memory_order_relaxed);
+
+        ReportIncumbent(false);
+    }
+
+    return stopped.load(memory_order_relaxed);
+}
+
+
+
+void MultiGeneReconciler::AddAbandonedBranch(double estimate)
+{
+    unique_lock<mutex> lock(incumbentMutex);
+    abandonedLowerBound = min(abandonedLowerBound, estimate);
+}
+
+
+
+void MultiGeneReconciler::AddPrunedBranch(double estimate, int dupHeightSum)
+{
+    if (!isAutoMaxDupHeight || incumbentCost.load(memory_order_relaxed) < estimate)
+        return;
+
+    //most branches change neither minimum, and only read them
+    double cost = prunedLowerBound.load(memory_order_relaxed);
+    while (estimate < cost && !prunedLowerBound.compare_exchange_weak(cost, estimate, memory_order_relaxed))
+    {
+    }
+
+    int height = prunedDupHeight.load(memory_order_relaxed);
+    while (dupHeightSum < height && !prunedDupHeight.compare_exchange_weak(height, dupHeightSum, memory_order_relaxed))
+    {
+    }
+}
+
+
+
+void MultiGeneReconciler::ReportIncumbent(bool force)
+{
+    if (!incumbentCallback)
+        return;
+
+    unique_lock<mutex> callbackLock(callbackMutex, defer_lock);
+    if (force)
+        callbackLock.lock();
+    else if (!callbackLock.try_lock())
+        return;
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    chrono::duration<double> sinceLastReport = now - lastReportTime;
+    if (!force && sinceLastReport.count() < incumbentCallbackInterval)
+        return;
+
+    MultiGeneReconcilerInfo info;
+    {
+        unique_lock<mutex> lock(incumbentMutex);
+        if (incumbentVersion == reportedVersion)
+            return;
+        info = currentBestInfo;
+        reportedVersion = incumbentVersion;
+    }
+
+    info.partialMapping = GetNodeMapping(info.idMapping);
+    lastReportTime = now;
+    incumbentCallback(info, incumbentCallbackData);
+}
+
+
+
+int MultiGeneReconciler::ApplyBranch(MultiGeneReconcilerState &state, vector<int> &minimalNodes, int lowest, int s)
+{
+    vector<int> &partialMapping = state.partialMapping;
+    int nblosses = 0;
+
+    state.Set(state.duplicationHeights[s], state.duplicationHeights[s] + 1);    //requires proof, see paper
+
+    //figure out which minimal nodes can go to s before mapping anything
+    vector<int> toMap;
+    toMap.push_back(lowest);
+    for (int j = 0; j < minimalNodes.size(); j++)
+    {
+        int g = minimalNodes[j];
+
+        if (g != lowest && HasSpeciesAncestor(GetLowestPossibleMapping(g, partialMapping), s))
         {
-            int local_nblosses = info.nbLosses;
-            Node* s = sps[i];
-            unordered_map<Node*, Node*> local_partialMapping(partialMapping);   //copy constructor called here
-            unordered_map<Node*, int> local_duplicationHeights(duplicationHeights);   //copy constructor called here
+            toMap.push_back(g);
+        }
+    }
+
+    //Map every minimal node that can be mapped to s.  If a parent becomes minimal, we'll have to clean it up.
+    vector<int> new_minimals;
+    for (int j = 0; j < toMap.size(); j++)
+    {
+        int g = toMap[j];
+
+        nblosses += GetSpeciesTreeDistance(s, partialMapping[geneChildren0[g]]);
+        nblosses += GetSpeciesTreeDistance(s, partialMapping[geneChildren1[g]]);
+
+        int newMinimal = MapNode(state, g, s);
+        if (newMinimal != -1)
+        {
+            new_minimals.push_back(newMinimal);
+        }
+    }
+
+    //CLEANUP PHASE
+    nblosses += CleanupPartialMapping(state, new_minimals);
+
+    return nblosses;
+}
+
+
+
+void MultiGeneReconciler::SeedIncumbent(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info)
+{
+    int trailSize = state.GetTrailSize();
+    uint64 topsHash = state.topsHash;
+    MultiGeneReconcilerInfo diveInfo = info;
 
-            local_duplicationHeights[s] = duplicationHeights[s] + 1;    //requires proof, see paper
+    //with MAX_DUP_HEIGHT_AUTO, any mapping bounds the cost of the best one, whatever the max dup height of the round
+    int diveMaxDupHeight = (isAutoMaxDupHeight ? numeric_limits<int>::max() : maxDupHeight);
 
-            local_partialMapping[lowest] = s;
+    while (state.frontierSize > 0)
+    {
+        int lowest = GetLowestMinimalNode(state);
+        vector<int> sps = GetPossibleSpeciesMapping(lowest, state.partialMapping);
+        vector<int> minimalNodes(state.frontier.begin(), state.frontier.begin() + state.frontierSize);
 
-            local_nblosses += GetSpeciesTreeDistance(s, local_partialMapping[lowest->GetChild(0)]);
-            local_nblosses += GetSpeciesTreeDistance(s, local_partialMapping[lowest->GetChild(1)]);
+        //try every branch, and keep the first one with the smallest cost + lower bound
+        int bestSpecies = -1;
+        double bestEstimate = numeric_limits<double>::infinity();
+        for (int i = 0; i < sps.size(); i++)
+        {
+            int branchTrailSize = state.GetTrailSize();
+            uint64 branchTopsHash = state.topsHash;
 
-            vector<Node*> new_minimals;
-            //if parent has become minimal, we'll have to add it
-            if (!lowest->IsRoot() && IsMinimalUnmapped(lowest->GetParent(), local_partialMapping))
+            MultiGeneReconcilerInfo estimate;
+            estimate.nbLosses = diveInfo.nbLosses + ApplyBranch(state, minimalNodes, lowest, sps[i]);
+            estimate.dupHeightSum = diveInfo.dupHeightSum + 1;
+
+            if (state.frontierSize > 0)
             {
-                new_minimals.push_back(lowest->GetParent());
+                int nbDups = 0;
+                int nbLosses = 0;
+                GetLowerBound(state, nbDups, nbLosses);
+                estimate.dupHeightSum += nbDups;
+                estimate.nbLosses += nbLosses;
             }
 
-            //Map every minimal node that can be mapped to s
-            for (int j = 0; j < minimalNodes.size(); j++)
+            if (estimate.dupHeightSum <= diveMaxDupHeight && estimate.GetCost(dupcost, losscost) < bestEstimate)
             {
-                Node* g = minimalNodes[j];
+                bestSpecies = sps[i];
+                bestEstimate = estimate.GetCost(dupcost, losscost);
+            }
 
-                if (g != lowest)
-                {
-                    Node* sg = GetLowestPossibleMapping(g, local_partialMapping);
+            state.Undo(branchTrailSize);
+            state.topsHash = branchTopsHash;
+        }
 
-                    if (sg->HasAncestor(s))
-                    {
-                        local_partialMapping[g] = s;
+        //every branch goes over the max dup height
+        if (bestSpecies == -1)
+            break;
 
-                        local_nblosses += GetSpeciesTreeDistance(s, local_partialMapping[g->GetChild(0)]);
-                        local_nblosses += GetSpeciesTreeDistance(s, local_partialMapping[g->GetChild(1)]);
+        diveInfo.nbLosses += ApplyBranch(state, minimalNodes, lowest, bestSpecies);
+        diveInfo.dupHeightSum++;
+    }
 
-                        if (!g->IsRoot() && IsMinimalUnmapped(g->GetParent(), local_partialMapping))
-                        {
-                            new_minimals.push_back(g->GetParent());
-                        }
+    //the seed has no path: it loses ties against every solution of the search, so that the search returns what it did without it
+    if (state.frontierSize == 0)
+    {
+        currentBestInfo = diveInfo;
+        currentBestInfo.isBad = false;
+        currentBestInfo.idMapping = state.partialMapping;
+        currentBestPath = vector<int>(1, numeric_limits<int>::max());
+        incumbentCost = diveInfo.GetCost(dupcost, losscost);
+    }
 
-                    }
-                }
-            }
+    state.Undo(trailSize);
+    state.topsHash = topsHash;
+}
+
+
+
+void MultiGeneReconciler::ReconcileRecursive(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info)
+{
+    //IMPORTANT ASSERTION: partialMapping is clean
+
+    bool mustStop = VisitNode();
+
+    //ASSERTION 2 : dupheights is smaller than maxDupheight
+    if (info.dupHeightSum > maxDupHeight)
+    {
+        AddPrunedBranch(info.GetCost(dupcost, losscost), info.dupHeightSum);
+        return;
+    }
+
+    //this makes this more of a branch-and-bound algorithm now...
+    if (incumbentCost.load(memory_order_relaxed) < info.GetCost(dupcost, losscost))
+    {
+        return;
+    }
+
+    //same, but accounting for what the unmapped nodes will cost for sure
+    double estimate = info.GetCost(dupcost, losscost);
+    if (state.frontierSize > 0)
+    {
+        MultiGeneReconcilerInfo boundInfo;
+        GetLowerBound(state, boundInfo.dupHeightSum, boundInfo.nbLosses);
+        boundInfo.dupHeightSum += info.dupHeightSum;
+        boundInfo.nbLosses += info.nbLosses;
+        estimate = boundInfo.GetCost(dupcost, losscost);
+
+        if (incumbentCost.load(memory_order_relaxed) < estimate)
+        {
+            return;
+        }
 
-            //CLEANUP PHASE
-            int added_losses = CleanupPartialMapping(local_partialMapping, local_duplicationHeights, new_minimals);
-            local_nblosses += added_losses;
+        if (boundInfo.dupHeightSum > maxDupHeight)
+        {
+            AddPrunedBranch(estimate, boundInfo.dupHeightSum);
+            return;
+        }
+    }
+
+
+    vector<int> &partialMapping = state.partialMapping;
+
+    if (state.frontierSize == 0) //normally, this means the mapping is complete
+    {
+        UpdateIncumbent(state, info);
+    }
+    else if (mustStop)
+    {
+        AddAbandonedBranch(estimate);
+    }
+    else
+    {
+        int lowest = GetLowestMinimalNode(state);
+
+        vector<int> sps = GetPossibleSpeciesMapping(lowest, partialMapping);
+
+        //the frontier changes as we map nodes, so we work on a copy of it
+        vector<int> minimalNodes(state.frontier.begin(), state.frontier.begin() + state.frontierSize);
+
+        //we'll try mapping lowest to every possible species.  Each try is undone before the next one.
+        for (int i = 0; i < sps.size(); i++)
+        {
+            int trailSize = state.GetTrailSize();
+            uint64 topsHash = state.topsHash;
+            int local_nblosses = info.nbLosses;
+            int s = sps[i];
+
+            local_nblosses += ApplyBranch(state, minimalNodes, lowest, s);
 
             MultiGeneReconcilerInfo recursiveCallInfo;
             recursiveCallInfo.dupHeightSum = info.dupHeightSum + 1;
             recursiveCallInfo.nbLosses = local_nblosses;
-            recursiveCallInfo.partialMapping = local_partialMapping;
 
-            MultiGeneReconcilerInfo recursiveRetinfo = ReconcileRecursive(recursiveCallInfo, local_duplicationHeights);
+            state.path.push_back(i);
 
-            if (!recursiveRetinfo.isBad)
+            //if someone has nothing to do, they get this branch, otherwise we do it ourselves
+            if (pool && state.frontierSize > 0 && pool->HasIdleWorkers())
             {
-                if (recursiveCallInfo.GetCost(dupcost, losscost) < bestInfo.GetCost(dupcost, losscost))
-                    bestInfo = recursiveRetinfo;
+                pool->Submit(new MultiGeneReconcilerTask(this, state, recursiveCallInfo));
+            }
+            else
+            {
+                ReconcileRecursive(state, recursiveCallInfo);
             }
-        }
 
-        return bestInfo;
+            state.path.pop_back();
+            state.Undo(trailSize);
+            state.topsHash = topsHash;
+
+            //the branches not tried yet are abandoned
+            if (IsStopped())
+            {
+                AddAbandonedBranch(estimate);
+                break;
+            }
+        }
     }
 
 }
@@ -168,99 +752,128 @@ MultiGeneReconcilerInfo MultiGeneReconciler::ReconcileRecursive(MultiGeneReconci
 
 
 
-int MultiGeneReconciler::CleanupPartialMapping(unordered_map<Node*, Node*> &partialMapping, unordered_map<Node*, int> &duplicationheights, vector<Node*> &minimalNodes)
+int MultiGeneReconciler::CleanupPartialMapping(MultiGeneReconcilerState &state, vector<int> &minimalNodes)
 {
+    vector<int> &partialMapping = state.partialMapping;
+    vector<char> &inWorklist = state.inWorklist;
     int nblosses = 0;
+    int nbExamined = 0;
+    int nbSpeciations = 0;
+    int nbEasyDuplications = 0;
+
     //CLEANUP PHASE
     //we want to do: while there is an easy node, map it
-    //at this point, we know that minimals not in new_minimals cannot be speciations, nor mapped to s
-    //so there is no point in checking them.
-    while (minimalNodes.size() > 0)
+    //at this point, we know that minimals not in minimalNodes cannot be speciations, nor mapped to s
+    //so there is no point in checking them.  Also, the cleanup neither changes the children of a minimal node nor
+    //increases duplication heights, so a node that is not easy now stays so until the next branching.
+    //Hence each node is examined once: minimalNodes is a worklist (a stack) from which nodes are popped and either
+    //mapped or dropped, and to which parents are pushed when they become minimal.
+    int nbUnique = 0;
+    for (int j = 0; j < minimalNodes.size(); j++)
     {
-        for (int j = minimalNodes.size() - 1; j >= 0; j--)
+        int g = minimalNodes[j];
+        if (!inWorklist[g])
         {
-            Node* g = minimalNodes[j];
-            bool canBeSpec = !IsRequiredDuplication(g, partialMapping);
-            bool isEasyDup = IsEasyDuplication(g, partialMapping, duplicationheights);
-
-            if (canBeSpec || isEasyDup)
-            {
-                Node* s = GetLowestPossibleMapping(g, partialMapping);
+            inWorklist[g] = 1;
+            minimalNodes[nbUnique] = g;
+            nbUnique++;
+        }
+    }
+    minimalNodes.resize(nbUnique);
 
-                partialMapping[g] = s;
+    while (minimalNodes.size() > 0)
+    {
+        int g = minimalNodes.back();
+        minimalNodes.pop_back();
+        inWorklist[g] = 0;
+        nbExamined++;
 
-                nblosses += GetSpeciesTreeDistance(s, partialMapping[g->GetChild(0)]);
-                nblosses += GetSpeciesTreeDistance(s, partialMapping[g->GetChild(1)]);
+        int s = GetLowestPossibleMapping(g, partialMapping);
+        bool canBeSpec = !IsRequiredDuplication(g, partialMapping);
 
-                if (canBeSpec)
-                    nblosses -= 2;
+        if (canBeSpec || IsEasyDuplication(g, s, state))
+        {
+            nblosses += GetSpeciesTreeDistance(s, partialMapping[geneChildren0[g]]);
+            nblosses += GetSpeciesTreeDistance(s, partialMapping[geneChildren1[g]]);
 
-                //the parent of g might become minimal - we'll add it in this case.
-                //since we are iterating over new_minimals in the reverse order, this below works
-                if (!g->IsRoot() && IsMinimalUnmapped(g->GetParent(), partialMapping))
-                {
-                    minimalNodes.push_back(g->GetParent());
-                }
+            if (canBeSpec)
+            {
+                nblosses -= 2;
+                nbSpeciations++;
+            }
+            else
+            {
+                nbEasyDuplications++;
             }
 
-            //no point in considering g from now on - we remove it from further consideration.
-            minimalNodes.erase(minimalNodes.begin() + j);
+            //the parent of g might become minimal - we'll add it in this case.
+            int newMinimal = MapNode(state, g, s);
+            if (newMinimal != -1 && !inWorklist[newMinimal])
+            {
+                inWorklist[newMinimal] = 1;
+                minimalNodes.push_back(newMinimal);
+            }
         }
     }
 
+    MultiGeneReconcilerCleanupStats &stats = cleanupStats[pool ? pool->GetCurrentWorkerIndex() : 0];
+    stats.nbPasses++;
+    stats.nbExamined += nbExamined;
+    stats.nbSpeciations += nbSpeciations;
+    stats.nbEasyDuplications += nbEasyDuplications;
+
     return nblosses;
 }
 
 
 
-bool MultiGeneReconciler::IsEasyDuplication(Node* g, unordered_map<Node*, Node*> &partialMapping, unordered_map<Node*, int> &duplicationHeights)
+bool MultiGeneReconciler::IsEasyDuplication(int g, int lca, MultiGeneReconcilerState &state)
 {
-    if (!IsMinimalUnmapped(g, partialMapping))
+    if (!IsMinimalUnmapped(g, state.partialMapping))
     {
         cout<<"Error in IsEasyDuplication: g is not minimal."<<endl;
         throw "Error in IsEasyDuplication: g is not minimal.";
     }
 
-    Node* lca = GetLowestPossibleMapping(g, partialMapping);
-
     //get dup height of lca under g
-    int d1 = GetDuplicationHeightUnder(g->GetChild(0), lca, partialMapping);
-    int d2 = GetDuplicationHeightUnder(g->GetChild(1), lca, partialMapping);
+    int d1 = GetChainHeightUnder(geneChildren0[g], lca, state);
+    int d2 = GetChainHeightUnder(geneChildren1[g], lca, state);
 
     int h = 1 + max(d1, d2);
 
-    return (h <= duplicationHeights[lca]);
+    return (h <= state.duplicationHeights[lca]);
 
 }
 
 
-int MultiGeneReconciler::GetDuplicationHeightUnder(Node* g, Node* species, unordered_map<Node*, Node*> &partialMapping)
+bool MultiGeneReconciler::IsDuplication(Node* g, unordered_map<Node*, Node*> &partialMapping)
 {
-    if (!IsDuplication(g, partialMapping) || partialMapping[g] != species)
-        return 0;
+    if (g->IsLeaf())
+        return false;
 
-    int d1 = GetDuplicationHeightUnder(g->GetChild(0), species, partialMapping);
-    int d2 = GetDuplicationHeightUnder(g->GetChild(1), species, partialMapping);
+    int s = speciesIndex->GetId(partialMapping[g]);
+    int s1 = speciesIndex->GetId(partialMapping[g->GetChild(0)]);
+    int s2 = speciesIndex->GetId(partialMapping[g->GetChild(1)]);
 
-    return 1 + max(d1, d2);
+    return IsDuplication(s, s1, s2);
 }
 
 
-
-
-bool MultiGeneReconciler::IsDuplication(Node* g, unordered_map<Node*, Node*> &partialMapping)
+bool MultiGeneReconciler::IsDuplication(int g, vector<int> &partialMapping)
 {
-    if (g->IsLeaf())
+    if (geneChildren0[g] == -1)
         return false;
 
-    Node* s = partialMapping[g];
-    Node* s1 = partialMapping[g->GetChild(0)];
-    Node* s2 = partialMapping[g->GetChild(1)];
+    return IsDuplication(partialMapping[g], partialMapping[geneChildren0[g]], partialMapping[geneChildren1[g]]);
+}
+
 
-    if (s1->HasAncestor(s2) || s2->HasAncestor(s1))
+bool MultiGeneReconciler::IsDuplication(int s, int s1, int s2)
+{
+    if (HasSpeciesAncestor(s1, s2) || HasSpeciesAncestor(s2, s1))
         return true;
 
-    if (s != s1->FindLCAWith(s2))
+    if (s != GetSpeciesLCA(s1, s2))
         return true;
 
     return false;
@@ -269,24 +882,24 @@ bool MultiGeneReconciler::IsDuplication(Node* g, unordered_map<Node*, Node*> &pa
 
 
 
-vector<Node*> MultiGeneReconciler::GetPossibleSpeciesMapping(Node* minimalNode, unordered_map<Node*, Node*> &partialMapping)
+vector<int> MultiGeneReconciler::GetPossibleSpeciesMapping(int minimalNode, vector<int> &partialMapping)
 {
-    Node* s = GetLowestPossibleMapping(minimalNode, partialMapping);
+    int s = GetLowestPossibleMapping(minimalNode, partialMapping);
 
-    vector<Node*> sps;
+    vector<int> sps;
 
     bool done = false;
     while (!done)
     {
         sps.push_back(s);
 
-        if (s->IsRoot() || sps.size() >= (int)(dupcost/losscost))
+        if (speciesIndex->GetParent(s) == -1 || sps.size() >= GetMaxNbPossibleSpecies())
         {
             done = true;
         }
         else
         {
-            s = s->GetParent();
+            s = speciesIndex->GetParent(s);
         }
     }
 
@@ -295,17 +908,21 @@ vector<Node*> MultiGeneReconciler::GetPossibleSpeciesMapping(Node* minimalNode,
 
 
 
-Node* MultiGeneReconciler::GetLowestMinimalNode(vector<Node*> &minimalNodes, unordered_map<Node*, Node*> &partialMapping)
+int MultiGeneReconciler::GetLowestMinimalNode(MultiGeneReconcilerState &state)
 {
-    Node* curmin = minimalNodes[0];
-    Node* curlca = GetLowestPossibleMapping(curmin, partialMapping);
+    //the frontier is in no particular order
+    vector<int> minimalNodes(state.frontier.begin(), state.frontier.begin() + state.frontierSize);
+    sort(minimalNodes.begin(), minimalNodes.end());
+
+    int curmin = minimalNodes[0];
+    int curlca = GetLowestPossibleMapping(curmin, state.partialMapping);
 
     for (int i = 1; i < minimalNodes.size(); i++)
     {
-        Node* lca = GetLowestPossibleMapping(minimalNodes[i], partialMapping);
+        int lca = GetLowestPossibleMapping(minimalNodes[i], state.partialMapping);
 
         //if lowest possible mapping of i-th node is strictly below current, it becomes current
-        if (lca->HasAncestor(curlca) && curlca != lca)
+        if (lca != curlca && speciesIndex->HasAncestor(lca, curlca))
         {
             curmin = minimalNodes[i];
             curlca = lca;
@@ -317,54 +934,160 @@ Node* MultiGeneReconciler::GetLowestMinimalNode(vector<Node*> &minimalNodes, uno
 
 
 
-void MultiGeneReconciler::ComputeLCAMapping()
+void MultiGeneReconciler::ComputeNodeIds(unordered_map<Node*, Node*> &geneSpeciesMapping)
 {
-    lcaMapping.clear();
+    //the index gives the species ids
+    speciesIndex = new LCAIndex(speciesTree);
+
+
+    //A gene node is fixed if its subtree only has speciations under the lca mapping.  Before the search, the cleanup maps the
+    //lowest minimal nodes that are speciations on their lca, so a fixed subtree ends up mapped that way in every solution.
+    //Each maximal fixed subtree is then contracted: its root keeps an id, as a leaf mapped to its lca, and the nodes below get none.
+    contractedLosses = 0;
+    kernelStats = MultiGeneReconcilerKernelStats();
+
     for (int i = 0; i < geneTrees.size(); i++)
     {
-        Node* g = geneTrees[i];
+        geneFlatTrees.push_back(FlatTree(geneTrees[i]));
+        FlatTree &tree = geneFlatTrees.back();
+        tree.SetLeafSpecies(geneSpeciesMapping, speciesIndex);
+        vector<int> lcas = GeneSpeciesTreeUtil::Instance()->GetLCAMapping(&tree, speciesIndex);
+
+        //flat ids are in post-order, so children are handled before their parent
+        vector<char> isFixed(tree.GetNbNodes(), 0);
+        for (int x = 0; x < tree.GetNbNodes(); x++)
+        {
+            if (tree.IsLeaf(x))
+            {
+                isFixed[x] = 1;
+            }
+            else
+            {
+                int c0 = tree.GetFirstChild(x);
+                int c1 = tree.GetNextSibling(c0);
+
+                if (isFixed[c0] && isFixed[c1] && !IsDuplication(lcas[x], lcas[c0], lcas[c1]))
+                {
+                    isFixed[x] = 1;
+                    contractedLosses += GetSpeciesTreeDistance(lcas[x], lcas[c0]) + GetSpeciesTreeDistance(lcas[x], lcas[c1]) - 2;
+                }
+            }
+        }
 
-        TreeIterator* it = g->GetPostOrderIterator();
-        while (Node* n = it->next())
+        //the gene ids keep the post-order of the flat ids, so the search branches in the same order as on the whole trees
+        vector<int> ids(tree.GetNbNodes(), -1);
+        for (int x = 0; x < tree.GetNbNodes(); x++)
         {
-            if (n->IsLeaf())
+            kernelStats.nbGeneNodes++;
+
+            int p = tree.GetParent(x);
+            if (p != -1 && isFixed[p])
             {
-                lcaMapping[n] = geneSpeciesMapping[n];
+                contractedNodes.push_back(make_pair(tree.GetNode(x), lcas[x]));
+                continue;
+            }
+
+            int g = geneNodes.size();
+            ids[x] = g;
+            geneNodes.push_back(tree.GetNode(x));
+            geneParents.push_back(-1);
+            lcaMapping.push_back(lcas[x]);
+
+            //the roots of the contracted subtrees are leaves for the search
+            if (isFixed[x])
+            {
+                geneChildren0.push_back(-1);
+                geneChildren1.push_back(-1);
+
+                if (!tree.IsLeaf(x))
+                    kernelStats.nbContractedSubtrees++;
             }
             else
             {
-                lcaMapping[n] = lcaMapping[n->GetChild(0)]->FindLCAWith(lcaMapping[n->GetChild(1)]);
+                int c0 = tree.GetFirstChild(x);
+                int c1 = tree.GetNextSibling(c0);
+                geneChildren0.push_back(ids[c0]);
+                geneChildren1.push_back(ids[c1]);
+                geneParents[ids[c0]] = g;
+                geneParents[ids[c1]] = g;
             }
         }
-        g->CloseIterator(it);
     }
+
+    kernelStats.nbKernelNodes = geneNodes.size();
+    kernelStats.nbContractedLosses = contractedLosses;
 }
 
 
 
-bool MultiGeneReconciler::IsMapped(Node* g, unordered_map<Node*, Node*> &partialMapping)
+unordered_map<Node*, Node*> MultiGeneReconciler::GetNodeMapping(vector<int> &idMapping)
 {
-    return ( partialMapping.find(g) != partialMapping.end() );
+    unordered_map<Node*, Node*> mapping;
+    for (int g = 0; g < idMapping.size(); g++)
+    {
+        if (idMapping[g] != -1)
+            mapping[geneNodes[g]] = speciesIndex->GetNode(idMapping[g]);
+    }
+
+    //the contracted subtrees are mapped to the lca in every solution
+    for (int i = 0; i < contractedNodes.size(); i++)
+    {
+        mapping[contractedNodes[i].first] = speciesIndex->GetNode(contractedNodes[i].second);
+    }
+
+    return mapping;
 }
 
 
-vector<Node*> MultiGeneReconciler::GetMinimalUnmappedNodes(unordered_map<Node*, Node*> &partialMapping)
+
+int MultiGeneReconciler::GetSpeciesLCA(int x, int y)
 {
-    vector<Node*> minimalNodes;
+    return speciesIndex->GetLCA(x, y);
+}
 
 
-    for (int i = 0; i < geneTrees.size(); i++)
+vector<int> &MultiGeneReconciler::GetBoundScratch()
+{
+    return boundScratches[pool ? pool->GetCurrentWorkerIndex() : 0];
+}
+
+
+int MultiGeneReconciler::GetSpeciesDepth(int s)
+{
+    return speciesIndex->GetDepth(s);
+}
+
+
+int MultiGeneReconciler::GetMaxNbPossibleSpecies()
+{
+    return max(1, (int)(dupcost/losscost));
+}
+
+
+bool MultiGeneReconciler::HasSpeciesAncestor(int x, int ancestor)
+{
+    return speciesIndex->HasAncestor(x, ancestor);
+}
+
+
+
+bool MultiGeneReconciler::IsMapped(int g, vector<int> &partialMapping)
+{
+    return ( partialMapping[g] != -1 );
+}
+
+
+vector<int> MultiGeneReconciler::GetMinimalUnmappedNodes(vector<int> &partialMapping)
+{
+    vector<int> minimalNodes;
+
+    //ids follow the post-order of each gene tree
+    for (int g = 0; g < geneNodes.size(); g++)
     {
-        Node* genetree = geneTrees[i];
-        TreeIterator* it = genetree->GetPostOrderIterator();
-        while (Node* g = it->next())
+        if (IsMinimalUnmapped(g, partialMapping))
         {
-            if (IsMinimalUnmapped(g, partialMapping))
-            {
-                minimalNodes.push_back(g);
-            }
+            minimalNodes.push_back(g);
         }
-        genetree->CloseIterator(it);
     }
 
 
@@ -372,31 +1095,65 @@ vector<Node*> MultiGeneReconciler::GetMinimalUnmappedNodes(unordered_map<Node*,
 }
 
 
-bool MultiGeneReconciler::IsMinimalUnmapped(Node* g, unordered_map<Node*, Node*> &partialMapping)
+int MultiGeneReconciler::MapNode(MultiGeneReconcilerState &state, int g, int s)
+{
+    //the children of g are no longer top nodes, and g becomes one
+    int c0 = geneChildren0[g];
+    int c1 = geneChildren1[g];
+    state.topsHash ^= GetTopHash(c0, state.partialMapping[c0]) ^ GetTopHash(c1, state.partialMapping[c1]);
+    if (geneParents[g] != -1)
+        state.topsHash ^= GetTopHash(g, s);
+
+    state.Set(state.partialMapping[g], s);
+    state.Set(state.nbUnmapped, state.nbUnmapped - 1);
+
+    //the children are mapped, so their chain heights are known.  Unmapped nodes have chain height 0, so there is nothing to record otherwise.
+    if (IsDuplication(s, state.partialMapping[c0], state.partialMapping[c1]))
+    {
+        int h = 1 + max(GetChainHeightUnder(c0, s, state), GetChainHeightUnder(c1, s, state));
+        state.Set(state.chainHeights[g], h);
+    }
+
+    if (state.frontierPositions[g] != -1)
+        state.RemoveFromFrontier(g);
+
+    int parent = geneParents[g];
+    if (parent != -1 && IsMinimalUnmapped(parent, state.partialMapping))
+    {
+        state.AddToFrontier(parent);
+        return parent;
+    }
+
+    return -1;
+}
+
+
+bool MultiGeneReconciler::IsMinimalUnmapped(int g, vector<int> &partialMapping)
 {
     return (!IsMapped(g, partialMapping) &&
-            IsMapped(g->GetChild(0), partialMapping) &&
-            IsMapped(g->GetChild(1), partialMapping));
+            geneChildren0[g] != -1 &&
+            IsMapped(geneChildren0[g], partialMapping) &&
+            IsMapped(geneChildren1[g], partialMapping));
 }
 
 
 
-Node* MultiGeneReconciler::GetLowestPossibleMapping(Node* g, unordered_map<Node*, Node*> &partialMapping)
+int MultiGeneReconciler::GetLowestPossibleMapping(int g, vector<int> &partialMapping)
 {
     string err = "";
-    if (g->IsLeaf())
+    if (geneChildren0[g] == -1)
     {
         err = "g is a leaf.";
     }
-    if (IsMapped(g, partialMapping))
+    else if (IsMapped(g, partialMapping))
     {
         err = "g is already mapped.";
     }
-    if (!IsMapped(g->GetChild(0), partialMapping))
+    else if (!IsMapped(geneChildren0[g], partialMapping))
     {
         err = "g's child 0 is not mapped.";
     }
-    if (!IsMapped(g->GetChild(1), partialMapping))
+    else if (!IsMapped(geneChildren1[g], partialMapping))
     {
         err = "g's child 1 is not mapped.";
     }
@@ -407,23 +1164,23 @@ Node* MultiGeneReconciler::GetLowestPossibleMapping(Node* g, unordered_map<Node*
         throw "Error in GetLowestPossibleMapping: " + err;
     }
 
-    return partialMapping[g->GetChild(0)]->FindLCAWith(partialMapping[g->GetChild(1)]);
+    return GetSpeciesLCA(partialMapping[geneChildren0[g]], partialMapping[geneChildren1[g]]);
 
 }
 
 
-bool MultiGeneReconciler::IsRequiredDuplication(Node* g, unordered_map<Node*, Node*> &partialMapping)
+bool MultiGeneReconciler::IsRequiredDuplication(int g, vector<int> &partialMapping)
 {
     //See the required duplication Lemma in the paper to see that this works
 
-    if (g->IsLeaf())
+    if (geneChildren0[g] == -1)
         return false;
 
-    Node* lca = lcaMapping[g];
-    Node* s1 = partialMapping[g->GetChild(0)];
-    Node* s2 = partialMapping[g->GetChild(1)];
+    int lca = lcaMapping[g];
+    int s1 = partialMapping[geneChildren0[g]];
+    int s2 = partialMapping[geneChildren1[g]];
 
-    return ( lca->HasAncestor(s1) || lca->HasAncestor(s2) );
+    return ( HasSpeciesAncestor(lca, s1) || HasSpeciesAncestor(lca, s2) );
 }
 
 
@@ -432,70 +1189,62 @@ bool MultiGeneReconciler::IsRequiredDuplication(Node* g, unordered_map<Node*, No
 double MultiGeneReconciler::GetMappingCost(unordered_map<Node*, Node*> &fullMapping)
 {
     double cost = 0;
-    int nbdups = 0;
     int nblosses = 0;
 
-    for (int i = 0; i < geneTrees.size(); i++)
+    //the mapping covers all the gene nodes, including the contracted ones, so the whole trees are traversed.
+    //Flat ids are in post-order, so the children of g are seen before g.
+    //chainHeights[g] is the height of the longest chain of duplications mapped to the species of g that ends at g,
+    //and the duplication height of a species is the maximum chain height of the nodes mapped to it.
+    vector<int> maxHeights(speciesIndex->GetNbNodes(), 0);
+
+    for (int i = 0; i < geneFlatTrees.size(); i++)
     {
-        Node* genetree = geneTrees[i];
+        FlatTree &tree = geneFlatTrees[i];
 
-        TreeIterator* it = genetree->GetPostOrderIterator();
+        vector<int> mapping(tree.GetNbNodes());
+        for (int x = 0; x < tree.GetNbNodes(); x++)
+        {
+            mapping[x] = speciesIndex->GetId(fullMapping[tree.GetNode(x)]);
+        }
 
-        while (Node* g = it->next())
+        vector<int> chainHeights(tree.GetNbNodes(), 0);
+        for (int g = 0; g < tree.GetNbNodes(); g++)
         {
-            if (!g->IsLeaf())
+            if (tree.IsLeaf(g))
+                continue;
+
+            int c0 = tree.GetFirstChild(g);
+            int c1 = tree.GetNextSibling(c0);
+            int s = mapping[g];
+            int s0 = mapping[c0];
+            int s1 = mapping[c1];
+            bool isdup = this->IsDuplication(s, s0, s1);
+
+            int losses_tmp = GetSpeciesTreeDistance(s, s0) + GetSpeciesTreeDistance(s, s1);
+            if (!isdup)
             {
-                bool isdup = this->IsDuplication(g, fullMapping);
-
-                int d1 = GetSpeciesTreeDistance(fullMapping[g], fullMapping[g->GetChild(0)]);
-                int d2 = GetSpeciesTreeDistance(fullMapping[g], fullMapping[g->GetChild(1)]);
-
-                int losses_tmp = (double)(d1 + d2);
-                if (!isdup)
-                {
-                    losses_tmp -= 2;
-                }
-                else
-                {
-                    //nbdups++;
-                    //cost += this->dupcost;
-                }
-
-                nblosses += losses_tmp;
-                cost += losses_tmp * this->losscost;
+                losses_tmp -= 2;
             }
-        }
+            else
+            {
+                int h0 = (s0 == s ? chainHeights[c0] : 0);
+                int h1 = (s1 == s ? chainHeights[c1] : 0);
+                chainHeights[g] = 1 + max(h0, h1);
 
-        genetree->CloseIterator(it);
+                if (chainHeights[g] > maxHeights[s])
+                    maxHeights[s] = chainHeights[g];
+            }
 
+            nblosses += losses_tmp;
+            cost += losses_tmp * this->losscost;
+        }
     }
 
     int dupheight = 0;
-
-    //COMPUTE DUP HEIGHTS THE HARD WAY...
-    TreeIterator* its = speciesTree->GetPostOrderIterator();
-    while (Node* s = its->next())
+    for (int s = 0; s < maxHeights.size(); s++)
     {
-        int maxh = 0;
-        for (int i = 0; i < geneTrees.size(); i++)
-        {
-            Node* genetree = geneTrees[i];
-
-            TreeIterator* it = genetree->GetPostOrderIterator();
-            while (Node* g = it->next())
-            {
-                //I know I know this is suboptimal.
-                int h = this->GetDuplicationHeightUnder(g, s, fullMapping);
-                if (h > maxh)
-                    maxh = h;
-            }
-            genetree->CloseIterator(it);
-        }
-
-        dupheight += maxh;
-
+        dupheight += maxHeights[s];
     }
-    speciesTree->CloseIterator(its);
 
     cost += dupheight * this->dupcost;
 
@@ -505,43 +1254,13 @@ double MultiGeneReconciler::GetMappingCost(unordered_map<Node*, Node*> &fullMapp
 
 
 
-int MultiGeneReconciler::GetSpeciesTreeDistance(Node* x, Node* y)
+int MultiGeneReconciler::GetSpeciesTreeDistance(int x, int y)
 {
-    if (speciesTreeDistances.find(x) != speciesTreeDistances.end())
-    {
-        if (speciesTreeDistances[x].find(y) != speciesTreeDistances[x].end())
-            return speciesTreeDistances[x][y];
-    }
-
-
-    int dist = 99999;
-    Node* d = NULL;
-    Node* a = NULL;   //d = descendant, y = ancestor
-    if (x->HasAncestor(y))
-    {
-        d = x;
-        a = y;
-    }
-    else if (y->HasAncestor(x))
-    {
-        d = y;
-        a = x;
-    }
-
-    if (d && a)
-    {
-        dist = 0;
-
-        while (d != a)
-        {
-            d = d->GetParent();
-            dist++;
-        }
-    }
-
-    speciesTreeDistances[x][y] = dist;
-    speciesTreeDistances[y][x] = dist;
-
-    return dist;
+    if (speciesIndex->HasAncestor(x, y))
+        return speciesIndex->GetDepth(x) - speciesIndex->GetDepth(y);
+    else if (speciesIndex->HasAncestor(y, x))
+        return speciesIndex->GetDepth(y) - speciesIndex->GetDepth(x);
+    else
+        return 99999;
 }
 
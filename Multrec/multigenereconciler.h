@@ -4,14 +4,31 @@
 #include <iostream>
 
 #include <map>
+#include <unordered_set>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <chrono>
 #include "div/util.h"
+#include "div/workstealingpool.h"
+#include "div/define.h"
+#include "transpositiontable.h"
 #include "trees/newicklex.h"
 #include "trees/node.h"
 #include "trees/genespeciestreeutil.h"
 #include "trees/treeiterator.h"
+#include "trees/lcaindex.h"
+#include "trees/flattree.h"
 
 using namespace std;
 
+//search modes of MultiGeneReconciler::SetSearchMode
+#define SEARCH_DEPTH_FIRST 0
+#define SEARCH_ASTAR 1
+
+//maxDupHeight of a MultiGeneReconciler that looks for the best mapping whatever its duplication heights (see Reconcile)
+#define MAX_DUP_HEIGHT_AUTO -1
+
 
 /**
  * @brief The MultiGeneReconcilerInfo class is a basic structure to hold
@@ -22,15 +39,28 @@ class MultiGeneReconcilerInfo
 {
 public:
     unordered_map<Node*, Node*> partialMapping;
+
+    //same mapping, but from gene node ids to species ids (see MultiGeneReconciler).  -1 means unmapped.
+    //partialMapping is filled from it when Reconcile returns.
+    vector<int> idMapping;
+
     int nbLosses;
     int dupHeightSum;
     bool isBad;
 
+    //set by Reconcile: isStopped is true iff a time or node limit stopped the search before it was done, in which case
+    //the mapping is the best one found so far.  lowerBound is a proven lower bound on the cost of the best mapping, which
+    //is the cost itself when the search was not stopped.
+    bool isStopped;
+    double lowerBound;
+
     MultiGeneReconcilerInfo()
     {
         isBad = false;
         nbLosses = 0;
         dupHeightSum = 0;
+        isStopped = false;
+        lowerBound = 0;
     }
 
     double GetCost(double dupcost, double losscost)
@@ -42,8 +72,230 @@ public:
 
 
 
+/**
+ * @brief The MultiGeneReconcilerCleanupStats class counts the work done by the cleanup phase, which maps the easy nodes
+ * (those that can be speciations, or duplications that do not increase any duplication height) after each branching.
+ */
+class MultiGeneReconcilerCleanupStats
+{
+public:
+    //number of times the cleanup phase ran: once before the search, then once per branch explored
+    uint64 nbPasses;
+
+    //number of minimal nodes taken off the worklist and tested
+    uint64 nbExamined;
+
+    //number of nodes mapped as speciations, and as duplications that did not increase duplication heights
+    uint64 nbSpeciations;
+    uint64 nbEasyDuplications;
+
+    //number of nodes mapped by the pass that runs before the search
+    uint64 nbResolvedAtRoot;
+
+    MultiGeneReconcilerCleanupStats()
+    {
+        nbPasses = 0;
+        nbExamined = 0;
+        nbSpeciations = 0;
+        nbEasyDuplications = 0;
+        nbResolvedAtRoot = 0;
+    }
+};
+
+
+
+/**
+ * @brief The MultiGeneReconcilerKernelStats class reports what the kernelization did when the reconciler was built: the gene subtrees
+ * whose internal nodes are all speciations under the lca mapping are mapped the same way in every solution, so each of them is
+ * contracted into a leaf before the search (see MultiGeneReconciler::ComputeNodeIds).
+ */
+class MultiGeneReconcilerKernelStats
+{
+public:
+    //number of nodes in the gene trees, and number of those left for the search
+    int nbGeneNodes;
+    int nbKernelNodes;
+
+    //number of subtrees contracted into a leaf, and the losses inside them
+    int nbContractedSubtrees;
+    int nbContractedLosses;
+
+    MultiGeneReconcilerKernelStats()
+    {
+        nbGeneNodes = 0;
+        nbKernelNodes = 0;
+        nbContractedSubtrees = 0;
+        nbContractedLosses = 0;
+    }
+};
+
+
+
+/**
+ * @brief The MultiGeneReconcilerAStarStats class reports what the A* search did (see MultiGeneReconciler::SetSearchMode).
+ */
+class MultiGeneReconcilerAStarStats
+{
+public:
+    //number of branches expanded best-first, not counting those explored depth-first after the memory limit was reached
+    uint64 nbExpanded;
+
+    //true iff the memory limit was reached and the remaining branches were explored depth-first
+    bool hasFallenBack;
+
+    MultiGeneReconcilerAStarStats()
+    {
+        nbExpanded = 0;
+        hasFallenBack = false;
+    }
+};
+
+
+
+/**
+ * @brief The MultiGeneReconcilerState class holds what changes from one branch of the search to another,
+ * namely the partial mapping (by gene id), the duplication height of each species (by species id) and
+ * the frontier, i.e. the minimal unmapped nodes (unmapped nodes whose two children are mapped).
+ * Every modification goes through Set, which records the previous value on a trail.  A branch remembers
+ * GetTrailSize() before modifying anything and calls Undo with it when done, so that exploring a branch
+ * costs time proportional to the number of entries it touches rather than to the size of the whole mapping.\n
+ * A copy of a state starts with an empty trail, so a copy can be handed to another thread and explored independently.\n
+ * The state also keeps a hash of the species of its top nodes, i.e. the mapped nodes whose parent is unmapped (gene tree roots
+ * excepted).  Since the unmapped nodes can only be mapped above them, these are all the lower bounds need to know about the mapping.
+ * The hash is not on the trail: whoever calls Undo also restores the hash it had saved.
+ */
+class MultiGeneReconcilerState
+{
+public:
+    vector<int> partialMapping;
+    vector<int> duplicationHeights;
+
+    //for each mapped gene id g, the height of the longest chain of duplications mapped to the same species as g
+    //that ends at g (0 if g is not a duplication).  Set once when g gets mapped.
+    vector<int> chainHeights;
+
+    //the frontier nodes are the first frontierSize entries of frontier, in no particular order.
+    //frontierPositions has one entry per gene id, giving its index in frontier, or -1 if it is not there.
+    vector<int> frontier;
+    vector<int> frontierPositions;
+    int frontierSize;
+
+    int nbUnmapped;
+
+    //xor of the MultiGeneReconciler::GetTopHash of the top nodes
+    uint64 topsHash;
+
+    //index of the branch taken at each level of the search, from the root.  Used to break ties between solutions of equal cost.
+    vector<int> path;
+
+    //one flag per gene id, set while the node is in the worklist of the cleanup phase.  All 0 outside of it, hence not on the trail.
+    vector<char> inWorklist;
+
+    MultiGeneReconcilerState()
+    {
+        frontierSize = 0;
+        nbUnmapped = 0;
+        topsHash = 0;
+    }
+
+    //the trail is not copied, since its entries point into the arrays of other
+    MultiGeneReconcilerState(const MultiGeneReconcilerState &other)
+    {
+        partialMapping = other.partialMapping;
+        duplicationHeights = other.duplicationHeights;
+        chainHeights = other.chainHeights;
+        frontier = other.frontier;
+        frontierPositions = other.frontierPositions;
+        frontierSize = other.frontierSize;
+        nbUnmapped = other.nbUnmapped;
+        topsHash = other.topsHash;
+        path = other.path;
+        inWorklist = other.inWorklist;
+    }
+
+    void Set(int &slot, int value)
+    {
+        trail.push_back(make_pair(&slot, slot));
+        slot = value;
+    }
+
+    void AddToFrontier(int g)
+    {
+        Set(frontier[frontierSize], g);
+        Set(frontierPositions[g], frontierSize);
+        Set(frontierSize, frontierSize + 1);
+    }
+
+    //the last frontier node takes the place of g
+    void RemoveFromFrontier(int g)
+    {
+        int pos = frontierPositions[g];
+        int last = frontier[frontierSize - 1];
+
+        Set(frontier[pos], last);
+        Set(frontierPositions[last], pos);
+        Set(frontierPositions[g], -1);
+        Set(frontierSize, frontierSize - 1);
+    }
+
+    int GetTrailSize()
+    {
+        return trail.size();
+    }
+
+    /**
+     * @brief Undo Reverts every modification made since the trail had size trailSize.
+     */
+    void Undo(int trailSize)
+    {
+        while (trail.size() > trailSize)
+        {
+            *(trail.back().first) = trail.back().second;
+            trail.pop_back();
+        }
+    }
+
+private:
+    //slot that was modified, and its value before the modification
+    vector< pair<int*, int> > trail;
+};
+
+
+
+class MultiGeneReconciler;
+
+
+/**
+ * @brief The MultiGeneReconcilerLowerBound class is an inheritable class for the lower bounds used by the branch-and-bound.
+ * Given a state of the search, a lower bound estimates the duplication heights and losses that any complete mapping
+ * extending the state will have to add.  The search abandons a state when its cost plus the estimate exceeds the best
+ * solution known, so the estimates must never be larger than the real values, or optimal solutions would be missed.
+ * Bounds are called concurrently during a parallel search and must not modify anything.  See reconcilerlowerbounds.h.\n
+ * The estimates are memoized by the reconciler using the hash of the top nodes of the state (see MultiGeneReconcilerState),
+ * so they must only depend on the species of the top nodes.
+ */
+class MultiGeneReconcilerLowerBound
+{
+public:
+    virtual ~MultiGeneReconcilerLowerBound() {}
+
+    /**
+     * @brief GetLowerBound
+     * @param reconciler The reconciler performing the search.
+     * @param state A clean state of the search, i.e. on which the cleanup phase has been applied.
+     * @param nbDups Set to a lower bound on the number of duplication heights still to add.
+     * @param nbLosses Set to a lower bound on the number of losses still to add.
+     */
+    virtual void GetLowerBound(MultiGeneReconciler* reconciler, MultiGeneReconcilerState &state, int &nbDups, int &nbLosses) = 0;
+};
+
+
+
 class MultiGeneReconciler
 {
+    friend class MultiGeneReconcilerTask;
+    friend class AStarSearch;
+
 public:
 
     /**
@@ -53,18 +305,126 @@ public:
      * @param geneSpeciesMapping A mapping from the leaves of the gene trees to the leaves of the species tree.
      * @param dupcost The cost for one level of duplication.
      * @param losscost The cost for each loss.
-     * @param maxDupHeight The maximum allowable duplication height.
+     * @param maxDupHeight The maximum allowable duplication height, or MAX_DUP_HEIGHT_AUTO.
      */
     MultiGeneReconciler(vector<Node*> &geneTrees, Node* speciesTree, unordered_map<Node*, Node*> &geneSpeciesMapping, double dupcost, double losscost, int maxDupHeight);
 
+    ~MultiGeneReconciler();
+
     /**
      * @brief Reconcile
      * Performs the reconciliation.  The return value contains the mapping, the sum of duplication heights and number of losses.
-     * If isBad is true in the returned info, then it means there exists no solution.
+     * If isBad is true in the returned info, then it means there exists no solution.\n
+     * With MAX_DUP_HEIGHT_AUTO, the search is first run with a maximum duplication height equal to the lower bound on the whole mapping,
+     * then with larger ones (iterative deepening).  Each round raises it by twice as much as the previous one did, since a round costs
+     * about as much as all the previous ones together, and at least up to the smallest one among the branches it pruned because of it.
+     * Each round starts with the best mapping of the previous one, and keeps the lower bounds memoized so far.  The rounds stop once
+     * the best mapping costs less than any of these pruned branches could, so that the result is the same as with a maximum large
+     * enough to never prune anything.
      * @return
      */
     MultiGeneReconcilerInfo Reconcile();
 
+    /**
+     * @brief GetMaxDupHeight
+     * Returns the maximum duplication height used by the last call to Reconcile.  With MAX_DUP_HEIGHT_AUTO, it is the one of the last round.
+     */
+    int GetMaxDupHeight();
+
+    /**
+     * @brief GetNbRounds
+     * Returns the number of rounds of the last call to Reconcile, which is 1 unless the max dup height is MAX_DUP_HEIGHT_AUTO.
+     */
+    int GetNbRounds();
+
+    /**
+     * @brief SetCosts
+     * Changes the costs used by the next calls to Reconcile.  What does not depend on them, like the node ids and the mapping of
+     * the easy nodes before the search, is kept from one call to the next.
+     */
+    void SetCosts(double dupcost, double losscost);
+
+    /**
+     * @brief SetStartingMapping
+     * Gives the next calls to Reconcile a mapping to start from, typically the one returned by a previous call with other costs.
+     * When it costs less than the first mapping Reconcile finds by itself, it prunes the search from the start instead.  It loses ties
+     * against the mappings of the search, so the result does not change, only the time it takes to get it.  info must come from
+     * Reconcile on this reconciler.  An info with isBad set means no starting mapping, which is the default.
+     */
+    void SetStartingMapping(MultiGeneReconcilerInfo &info);
+
+    /**
+     * @brief SetNbThreads
+     * Number of threads used by Reconcile (default 1).  With more than one, subtrees of the search are handed
+     * to a work-stealing pool whenever some thread is idle.  The result is the same as with one thread:
+     * among the solutions of minimum cost, the one returned is the first one in the order of the serial search,
+     * i.e. the one whose sequence of branch indices (see MultiGeneReconcilerState::path) is lexicographically smallest.
+     */
+    void SetNbThreads(int nbThreads);
+
+    /**
+     * @brief SetSearchMode
+     * SEARCH_DEPTH_FIRST (default) or SEARCH_ASTAR.  The A* search (see AStarSearch) expands the branches in order of cost + lower bound,
+     * and stops as soon as every remaining branch is worse than the best solution, which usually takes fewer expansions.
+     * It gives the same result as the depth-first search, but runs on a single thread.
+     */
+    void SetSearchMode(int searchMode);
+
+    /**
+     * @brief SetAStarMemory
+     * Memory that the A* search can use for its open branches, in megabytes (default 256).  When it is exhausted,
+     * the remaining branches are explored depth-first.
+     */
+    void SetAStarMemory(int megabytes);
+
+    /**
+     * @brief SetTimeLimit
+     * Maximum running time of Reconcile, in seconds (default 0, no limit).  When it is reached, Reconcile returns the best mapping
+     * found so far, with isStopped set and a lower bound taken from the branches left unexplored.
+     */
+    void SetTimeLimit(double seconds);
+
+    /**
+     * @brief SetNodeLimit
+     * Maximum number of nodes of the search tree visited by Reconcile (default 0, no limit).  Same as SetTimeLimit otherwise.
+     */
+    void SetNodeLimit(uint64 nbNodes);
+
+    /**
+     * @brief SetIncumbentCallback
+     * During Reconcile, callback is called with the best mapping found so far (partialMapping filled) and data whenever it has changed,
+     * at most once every interval seconds, and once more at the end if the last change was not reported.  It is called by
+     * whichever search thread notices it, one call at a time, so it should not take long.  NULL means no callback (the default).
+     */
+    void SetIncumbentCallback(void (*callback)(MultiGeneReconcilerInfo &info, void* data), void* data, double interval);
+
+    /**
+     * @brief GetNbVisitedNodes
+     * Returns the number of nodes of the search tree visited during the last call to Reconcile.
+     */
+    uint64 GetNbVisitedNodes();
+
+    /**
+     * @brief AddLowerBound
+     * Adds a lower bound to use for pruning the search.  The reconciler takes ownership of it.
+     * By default, the reconciler uses the ForcedLossesLowerBound and ForcedDuplicationsLowerBound.
+     * When several bounds are given, the search uses the largest estimate of each of them for the duplications and for the losses.
+     */
+    void AddLowerBound(MultiGeneReconcilerLowerBound* lowerBound);
+
+    /**
+     * @brief ClearLowerBounds
+     * Removes all the lower bounds, including the default ones.  The search then only prunes on the cost of the partial mapping.
+     */
+    void ClearLowerBounds();
+
+    /**
+     * @brief SetTranspositionTableMemory
+     * Memory given to the transposition table that memoizes the lower bounds of the states of the search, in megabytes (default 32).
+     * In a parallel search, each thread gets an equal share of it.  With 0, there is no table.
+     */
+    void SetTranspositionTableMemory(int megabytes);
+
     /**
      * @brief GetMappingCost
      * @param fullMapping A mapping of each node of each gene tree to the species tree.  We assume this mapping is valid without checking.
@@ -81,67 +441,267 @@ public:
      */
     bool IsDuplication(Node* g, unordered_map<Node*, Node*> &partialMapping);
 
+
+    //The following are queries on the ids used in a MultiGeneReconcilerState, mostly for the lower bounds.
+
+    //child 0 or 1 of gene id g, -1 if g is a leaf
+    int GetGeneChild(int g, int index)
+    {
+        return (index == 0 ? geneChildren0[g] : geneChildren1[g]);
+    }
+
+    //parent of gene id g, -1 if g is a root
+    int GetGeneParent(int g)
+    {
+        return geneParents[g];
+    }
+
+    //one int per gene id, all -1, owned by the calling worker during Reconcile.  A lower bound can use it as
+    //temporary storage, but must set the entries it changed back to -1 before returning.
+    vector<int> &GetBoundScratch();
+
+    //depth of species id s, the root having depth 0
+    int GetSpeciesDepth(int s);
+
+    //lca and ancestor queries on species ids, in constant time
+    int GetSpeciesLCA(int x, int y);
+    bool HasSpeciesAncestor(int x, int ancestor);
+
+    //returns the lowest node of the species tree on which g can be mapped, ie the lca of the mappings of the 2 children of g
+    int GetLowestPossibleMapping(int g, vector<int> &partialMapping);
+
+    //The maximum number of species tried for a node when branching: its lowest possible mapping and its ancestors,
+    //up to dupcost/losscost of them (at least 1).  Mapping higher would cost more in losses than a new duplication.
+    int GetMaxNbPossibleSpecies();
+
+    /**
+     * @brief GetCleanupStats
+     * Returns what the cleanup phase did during the last call to Reconcile, summed over all threads.
+     */
+    MultiGeneReconcilerCleanupStats GetCleanupStats();
+
+    /**
+     * @brief GetAStarStats
+     * Returns what the A* search did during the last call to Reconcile.  All zero if the search was depth-first.
+     */
+    MultiGeneReconcilerAStarStats GetAStarStats();
+
+    /**
+     * @brief GetKernelStats
+     * Returns how much of the gene trees is left for the search once the fixed subtrees are contracted.
+     */
+    MultiGeneReconcilerKernelStats GetKernelStats();
+
 private:
 
     vector<Node*> geneTrees;
     Node* speciesTree;
-    unordered_map<Node*, Node*> geneSpeciesMapping;
-    unordered_map<Node*, Node*> lcaMapping;
     double dupcost;
     double losscost;
     int maxDupHeight;
+    bool isAutoMaxDupHeight;
+    int nbRounds;
+
+    //with MAX_DUP_HEIGHT_AUTO, the smallest cost + lower bound and the smallest dup heights + lower bound of the branches pruned
+    //during the current round because of maxDupHeight, among those that could still beat the incumbent
+    atomic<double> prunedLowerBound;
+    atomic<int> prunedDupHeight;
+
+    //the clean state before the search, its losses, and the stats of the cleanup that made it.  None of them depend on the costs,
+    //so the first call to Reconcile computes them and the next ones copy them.
+    bool hasRootState;
+    MultiGeneReconcilerState rootState;
+    int rootLosses;
+    MultiGeneReconcilerCleanupStats rootCleanupStats;
+
+    //see SetStartingMapping
+    MultiGeneReconcilerInfo startingMapping;
+    int nbThreads;
+    int searchMode;
+    int astarMemory;
+
+    //the limits (0 for none), and the time at which Reconcile started
+    double timeLimit;
+    uint64 nodeLimit;
+    chrono::steady_clock::time_point startTime;
+
+    //number of nodes visited, and whether a limit was reached.  Shared by all the threads.
+    atomic<uint64> nbVisitedNodes;
+    atomic<bool> stopped;
+
+    //smallest cost + lower bound of the branches abandoned because of a limit, infinity if none.  Protected by incumbentMutex.
+    double abandonedLowerBound;
+
+    //see SetIncumbentCallback.  incumbentVersion changes with the incumbent (under incumbentMutex), and reportedVersion is
+    //the one last given to the callback.  Only one thread calls the callback at a time, the one holding callbackMutex.
+    void (*incumbentCallback)(MultiGeneReconcilerInfo &info, void* data);
+    void* incumbentCallbackData;
+    double incumbentCallbackInterval;
+    uint64 incumbentVersion;
+    uint64 reportedVersion;
+    chrono::steady_clock::time_point lastReportTime;
+    mutex callbackMutex;
+
+    //only exists during a parallel Reconcile
+    WorkStealingPool* pool;
+
+    vector<MultiGeneReconcilerLowerBound*> lowerBounds;
+
+    //combines the estimates of all the lower bounds on state, or gets them from the transposition table
+    void GetLowerBound(MultiGeneReconcilerState &state, int &nbDups, int &nbLosses);
+
+    //only exist during Reconcile, one per worker (a single one for a serial search)
+    vector<TranspositionTable*> transpositionTables;
+
+    //one per worker, like the transposition tables (see GetBoundScratch)
+    vector< vector<int> > boundScratches;
+
+    //one per thread, like the transposition tables.  Each thread only adds to its own, once per cleanup pass.
+    vector<MultiGeneReconcilerCleanupStats> cleanupStats;
+    MultiGeneReconcilerAStarStats astarStats;
+    int transpositionTableMemory;
+
+    //the value of top node g mapped to s in MultiGeneReconcilerState::topsHash
+    uint64 GetTopHash(int g, int s);
+
+    //Every gene node and every species node gets a dense integer id, so that mappings and dup heights
+    //can be stored in plain arrays instead of hash maps.  Ids are given in post-order, gene trees one after the other.
+    //Children and parent ids are -1 when absent.  The nodes below the root of a contracted subtree get no id, and
+    //the root is a leaf for the search (see ComputeNodeIds).
+    vector<Node*> geneNodes;
+    vector<int> geneParents;
+    vector<int> geneChildren0;
+    vector<int> geneChildren1;
+
+    //species ids are those of the index, which also answers the lca and ancestor queries in constant time
+    LCAIndex* speciesIndex;
+
+    //gene id -> species id
+    vector<int> lcaMapping;
+
+    //the whole gene trees, contracted subtrees included, for the passes that read their structure (see FlatTree)
+    vector<FlatTree> geneFlatTrees;
+
+    //the nodes that have no id because they are below the root of a contracted subtree, with the species id they are mapped to,
+    //and the losses of the contracted subtrees
+    vector< pair<Node*, int> > contractedNodes;
+    int contractedLosses;
+    MultiGeneReconcilerKernelStats kernelStats;
+
+    //Main recursive function for the computation of a mapping.  Takes the partial mapping in state and tries to map additional
+    //nodes, branching on the possible species of a minimal node.  The given mapping must be clean, and info holds its losses and
+    //dup heights.  Complete mappings that beat currentBestInfo replace it.  The state is left as it was received.
+    //During a parallel Reconcile, some branches are given to idle workers instead of being explored here.
+    void ReconcileRecursive(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info);
+
+    //Maps lowest to s along with every other minimal node that can go to s, which raises the duplication height of s by one,
+    //then cleans up.  minimalNodes is the frontier before the branching.  Returns the number of losses added.
+    int ApplyBranch(MultiGeneReconcilerState &state, vector<int> &minimalNodes, int lowest, int s);
+
+    //Installs a first incumbent before the search, so that it can prune from the start.  It is found by a single greedy dive
+    //that takes, at each branching, the branch with the smallest cost plus lower bound.  Nothing is installed if the dive
+    //runs over the max dup height, unless it is MAX_DUP_HEIGHT_AUTO.  The state is left as it was received.
+    void SeedIncumbent(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info);
+
+    //fills rootState, rootLosses and rootCleanupStats.  cleanupStats must be allocated.
+    void ComputeRootState();
+
+    //searches the mappings under the clean state, with the search mode and number of threads set, for one value of maxDupHeight.
+    //info holds the losses and dup heights of state.  The state is left as it was received.
+    void SearchRound(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info);
+
+    //holds the current best solution, so that we can do some branch-and-bound early stop if we know we acnnot beat this in a recursion.
+    //Among solutions of equal cost, the one with the smallest path is kept.  Both are protected by incumbentMutex.
+    MultiGeneReconcilerInfo currentBestInfo;
+    vector<int> currentBestPath;
+    mutex incumbentMutex;
 
-    //Main recursive function for the computation of a mapping.  Takes the partial mapping in info and tries to map additional
-    //nodes.  The given mapping must be clean.  Returns a MultiGeneReconcilerInfo containing a complete mapping if one can be
-    //found.  If not, the returned info object will have isBad = true.  The variable duplicationHeights has one entry for each species.
-    MultiGeneReconcilerInfo ReconcileRecursive(MultiGeneReconcilerInfo &info, unordered_map<Node*, int> &duplicationHeights);
+    //cost of currentBestInfo, infinity if there is none.  It is read without locking at every node of the search,
+    //so that a solution found by one worker prunes the branches of all the others right away.  Only written under incumbentMutex.
+    atomic<double> incumbentCost;
 
-    //holds the current best solution, so that we can do some branch-and-bound early stop if we know we acnnot beat this in a recursion
-    MultiGeneReconcilerInfo currentBestInfo;
+    //replaces the incumbent by the complete mapping of state if it is better
+    void UpdateIncumbent(MultiGeneReconcilerState &state, MultiGeneReconcilerInfo &info);
 
-    //key1 = species 1, key2 = species2, int = dist.  Not sure how well this performs, but let's try
-    unordered_map< Node*, unordered_map<Node*, int> > speciesTreeDistances;
+    //Counts a visited node of the search, and every 64 nodes checks the time limit and reports the incumbent if due.
+    //Returns true iff a limit has been reached, in which case the node must not be explored further.
+    bool VisitNode();
 
-    //fills up the lcaMapping variables
-    void ComputeLCAMapping();
+    //true iff a limit has been reached
+    bool IsStopped()
+    {
+        return stopped.load(memory_order_relaxed);
+    }
 
-    //true iff g is a key in partialMapping
-    bool IsMapped(Node* g, unordered_map<Node*, Node*> &partialMapping);
+    //records that a branch of the search is abandoned because of a limit.  estimate is a lower bound on the cost of its mappings.
+    void AddAbandonedBranch(double estimate);
 
-    //returns the lsit of unmapped nodes whose two children are mapped
-    vector<Node*> GetMinimalUnmappedNodes(unordered_map<Node*, Node*> &partialMapping);
+    //records that a branch of the search is pruned because its dup heights, or their lower bound dupHeightSum, exceed maxDupHeight.
+    //estimate is a lower bound on the cost of its mappings.
+    void AddPrunedBranch(double estimate, int dupHeightSum);
 
+    //gives the incumbent to the incumbent callback if it changed since the last call.  Unless force is true, only does so if the
+    //last call is at least incumbentCallbackInterval seconds old and no other thread is calling it.
+    void ReportIncumbent(bool force);
 
-    //returns the lowest node of the species tree on which g can be mapped, ie the lca of the mappings of the 2 children of g
-    Node* GetLowestPossibleMapping(Node* g, unordered_map<Node*, Node*> &partialMapping);
+    //assigns the gene and species ids, and fills the arrays indexed by them.  The subtrees whose internal nodes are all speciations
+    //under the lca mapping are contracted first: the cleanup before the search would map them entirely, whatever the costs, and
+    //nothing maps them otherwise afterwards.
+    void ComputeNodeIds(unordered_map<Node*, Node*> &geneSpeciesMapping);
+
+    //converts an id mapping into a Node* -> Node* mapping, which includes the nodes of the contracted subtrees
+    unordered_map<Node*, Node*> GetNodeMapping(vector<int> &idMapping);
+
+    //true iff g is mapped in partialMapping
+    bool IsMapped(int g, vector<int> &partialMapping);
+
+    //returns the lsit of unmapped nodes whose two children are mapped.  Only used to initialize the frontier, which
+    //is then maintained by MapNode.
+    vector<int> GetMinimalUnmappedNodes(vector<int> &partialMapping);
+
+    //maps g to s, removes g from the frontier and adds its parent if it has become minimal.  Also updates the hash of the top nodes.
+    //Returns the parent in that case, -1 otherwise.
+    int MapNode(MultiGeneReconcilerState &state, int g, int s);
+
+    //true iff a node mapped to s, with children mapped to s1 and s2, is a duplication
+    bool IsDuplication(int s, int s1, int s2);
+
+    bool IsDuplication(int g, vector<int> &partialMapping);
 
     //false iff mapping g anywhere valid makes it a duplication
-    bool IsRequiredDuplication(Node* g, unordered_map<Node*, Node*> &partialMapping);
+    bool IsRequiredDuplication(int g, vector<int> &partialMapping);
 
     //true iff g is unmapped but its children are
-    bool IsMinimalUnmapped(Node* g, unordered_map<Node*, Node*> &partialMapping);
+    bool IsMinimalUnmapped(int g, vector<int> &partialMapping);
 
-    //true iff mapping g to its lowest possible place does not incerase duplication heights
-    bool IsEasyDuplication(Node* g, unordered_map<Node*, Node*> &partialMapping, unordered_map<Node*, int> &duplicationHeights);
+    //true iff mapping g to its lowest possible place, lca, does not incerase duplication heights.  Constant time, using the chain heights.
+    bool IsEasyDuplication(int g, int lca, MultiGeneReconcilerState &state);
 
-    //returns the duplication height at species of the subtree rooted at g
-    int GetDuplicationHeightUnder(Node* g, Node* species, unordered_map<Node*, Node*> &partialMapping);
+    //returns the duplication height at species of the subtree rooted at g, ie the chain height of g if g is mapped to species
+    //and 0 otherwise.  g must be mapped.
+    int GetChainHeightUnder(int g, int species, MultiGeneReconcilerState &state)
+    {
+        return (state.partialMapping[g] == species ? state.chainHeights[g] : 0);
+    }
 
 
 
-    //returns a node in the minimal nodes whose species is the lowest possible (multiple choices are possible, returns the first)
-    Node* GetLowestMinimalNode(vector<Node*> &minimalNodes, unordered_map<Node*, Node*> &partialMapping);
+    //returns the frontier node to branch on.  The frontier is scanned in gene id order (the order of GetMinimalUnmappedNodes),
+    //starting from the first node, and a node replaces the current one if its lowest possible mapping is strictly below.
+    int GetLowestMinimalNode(MultiGeneReconcilerState &state);
 
     //returns the list of nodes on which minimalNode can be mapped to
-    vector<Node*> GetPossibleSpeciesMapping(Node* minimalNode, unordered_map<Node*, Node*> &partialMapping);
+    vector<int> GetPossibleSpeciesMapping(int minimalNode, vector<int> &partialMapping);
 
 
-    //Returns the number of edges between x and y in the species tree.  x and y must be comparable.
-    int GetSpeciesTreeDistance(Node* x, Node* y);
+    //Returns the number of edges between species ids x and y, ie their depth difference, in constant time.
+    //x and y must be comparable (99999 is returned otherwise).
+    int GetSpeciesTreeDistance(int x, int y);
 
-    //Applies the cleaning phase on a partialMapping by mapping easy nodes until none are left.
-    //This mapping can undergo modifications.  Only the minimal nodes and their ancestors can be modified.
-    int CleanupPartialMapping(unordered_map<Node *, Node *> &partialMapping, unordered_map<Node*, int> &duplicationheights, vector<Node*> &minimalNodes);
+    //Applies the cleaning phase on the mapping of state by mapping easy nodes until none are left.
+    //This mapping can undergo modifications (recorded on the trail).  Only the minimal nodes and their ancestors can be modified.
+    //minimalNodes serves as the worklist, and is empty on return.  Returns the number of losses added.
+    int CleanupPartialMapping(MultiGeneReconcilerState &state, vector<int> &minimalNodes);
 
 };
 
@@ -0,0 +1,104 @@
+#include "reconcilerlowerbounds.h"
+
+#include <algorithm>
+
+/**
+See reconcilerlowerbounds.h for documentation on the lower bounds.
+**/
+
+
+
+void ForcedLossesLowerBound::GetLowerBound(MultiGeneReconciler* reconciler, MultiGeneReconcilerState &state, int &nbDups, int &nbLosses)
+{
+    nbDups = 0;
+    nbLosses = 0;
+
+    //map every unmapped node to the lca of its children.  The unmapped nodes are the frontier nodes and their ancestors,
+    //so we go up from each frontier node, and stop at a parent whose other child is not done yet: it gets done from there.
+    vector<int> &partialMapping = state.partialMapping;
+    vector<int> &lowestMapping = reconciler->GetBoundScratch();
+    for (int i = 0; i < state.frontierSize; i++)
+    {
+        int g = state.frontier[i];
+        while (true)
+        {
+            int c1 = reconciler->GetGeneChild(g, 0);
+            int c2 = reconciler->GetGeneChild(g, 1);
+            int s1 = (partialMapping[c1] != -1 ? partialMapping[c1] : lowestMapping[c1]);
+            int s2 = (partialMapping[c2] != -1 ? partialMapping[c2] : lowestMapping[c2]);
+            int l = reconciler->GetSpeciesLCA(s1, s2);
+            lowestMapping[g] = l;
+
+            //l is an ancestor of s1 and s2, so the distances are depth differences
+            nbLosses += reconciler->GetSpeciesDepth(s1) - reconciler->GetSpeciesDepth(l);
+            nbLosses += reconciler->GetSpeciesDepth(s2) - reconciler->GetSpeciesDepth(l);
+
+            if (l != s1 && l != s2) //speciation
+                nbLosses -= 2;
+
+            int p = reconciler->GetGeneParent(g);
+            if (p == -1)
+                break;
+
+            int sibling = reconciler->GetGeneChild(p, 0);
+            if (sibling == g)
+                sibling = reconciler->GetGeneChild(p, 1);
+            if (partialMapping[sibling] == -1 && lowestMapping[sibling] == -1)
+                break;
+
+            g = p;
+        }
+    }
+
+    //reset the scratch array the same way.  A node reached a second time has already been reset, and so have its ancestors.
+    for (int i = 0; i < state.frontierSize; i++)
+    {
+        for (int g = state.frontier[i]; g != -1 && lowestMapping[g] != -1; g = reconciler->GetGeneParent(g))
+        {
+            lowestMapping[g] = -1;
+        }
+    }
+}
+
+
+
+void ForcedDuplicationsLowerBound::GetLowerBound(MultiGeneReconciler* reconciler, MultiGeneReconcilerState &state, int &nbDups, int &nbLosses)
+{
+    nbDups = 0;
+    nbLosses = 0;
+
+    if (state.frontierSize == 0)
+        return;
+
+    int k = reconciler->GetMaxNbPossibleSpecies();
+
+    //lowest possible mappings of the minimal nodes, deepest first
+    vector< pair<int, int> > lowests;
+    for (int i = 0; i < state.frontierSize; i++)
+    {
+        int l = reconciler->GetLowestPossibleMapping(state.frontier[i], state.partialMapping);
+        lowests.push_back(make_pair(-reconciler->GetSpeciesDepth(l), l));
+    }
+    sort(lowests.begin(), lowests.end());
+
+    //the lowest mappings of the nodes that pairwise cannot share a branching.  Since we go from the deepest,
+    //the depth of the deepest of a pair is the depth of the one already chosen.
+    vector<int> chosen;
+    for (int i = 0; i < lowests.size(); i++)
+    {
+        int l = lowests[i].second;
+        bool conflictsWithAll = true;
+
+        for (int j = 0; j < chosen.size() && conflictsWithAll; j++)
+        {
+            int lca = reconciler->GetSpeciesLCA(l, chosen[j]);
+            if (reconciler->GetSpeciesDepth(lca) >= reconciler->GetSpeciesDepth(chosen[j]) - (k - 1))
+                conflictsWithAll = false;
+        }
+
+        if (conflictsWithAll)
+            chosen.push_back(l);
+    }
+
+    nbDups = chosen.size();
+}
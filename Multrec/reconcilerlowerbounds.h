@@ -0,0 +1,39 @@
+#ifndef RECONCILERLOWERBOUNDS_H
+#define RECONCILERLOWERBOUNDS_H
+
+#include "multigenereconciler.h"
+
+using namespace std;
+
+
+/**
+ * @brief The ForcedLossesLowerBound class counts the losses that the unmapped nodes will cause at the very least.
+ * Mapping a node δ levels above the lca of the mappings of its children adds 2δ losses on its child edges, can turn
+ * a speciation into a duplication, and saves at most δ losses on its parent edge (the parent stays a speciation if it was one).
+ * Hence the completion that maps the unmapped nodes to the lca of their children, from the bottom up, has the fewest losses,
+ * and its losses are the bound.  This includes the d(l, s1) + d(l, s2) losses of each minimal node, l being its lowest possible mapping
+ * and s1, s2 the mappings of its children.
+ */
+class ForcedLossesLowerBound : public MultiGeneReconcilerLowerBound
+{
+public:
+    virtual void GetLowerBound(MultiGeneReconciler* reconciler, MultiGeneReconcilerState &state, int &nbDups, int &nbLosses);
+};
+
+
+
+/**
+ * @brief The ForcedDuplicationsLowerBound class counts the branchings that the minimal unmapped nodes will require.
+ * After the cleanup phase, the minimal nodes are required duplications that can only be mapped by branching, and each
+ * branching adds one duplication height.  A branching maps the minimal node c having the deepest lowest possible mapping l_c
+ * to some s at most k - 1 levels above l_c (k = GetMaxNbPossibleSpecies()), along with the other minimal nodes that fit under s.
+ * Two minimal nodes a and b can therefore share a branching only if lca(l_a, l_b) is at most k - 1 levels above the deepest of l_a, l_b.
+ * The bound is the size of a set of minimal nodes in which no two can share, found greedily from the deepest.
+ */
+class ForcedDuplicationsLowerBound : public MultiGeneReconcilerLowerBound
+{
+public:
+    virtual void GetLowerBound(MultiGeneReconciler* reconciler, MultiGeneReconcilerState &state, int &nbDups, int &nbLosses);
+};
+
+#endif // RECONCILERLOWERBOUNDS_H
@@ -0,0 +1,74 @@
+#include "transpositiontable.h"
+
+#include <cstdlib>
+
+/**
+See transpositiontable.h for documentation on methods in this class.
+**/
+
+
+TranspositionTable::TranspositionTable(size_t memoryLimit)
+{
+    //the number of buckets is a power of 2, so that the bucket of a key is given by its lower bits
+    size_t nbBuckets = 1;
+    while (nbBuckets * 4 * sizeof(Entry) <= memoryLimit)
+        nbBuckets *= 2;
+
+    if (nbBuckets * 2 * sizeof(Entry) > memoryLimit)
+        nbBuckets = 0;
+
+    nbEntries = nbBuckets * 2;
+    entries = NULL;
+    if (nbEntries > 0)
+        entries = (Entry*)calloc(nbEntries, sizeof(Entry));
+    if (!entries)
+        nbEntries = 0;
+
+    bucketMask = (nbBuckets > 0 ? nbBuckets - 1 : 0);
+}
+
+
+TranspositionTable::~TranspositionTable()
+{
+    free(entries);
+}
+
+
+bool TranspositionTable::Get(uint64 key, int &nbDups, int &nbLosses)
+{
+    if (nbEntries == 0)
+        return false;
+
+    size_t b = (size_t)(key & bucketMask) * 2;
+
+    for (size_t i = b; i < b + 2; i++)
+    {
+        if (entries[i].depth != 0 && entries[i].key == key)
+        {
+            nbDups = entries[i].nbDups;
+            nbLosses = entries[i].nbLosses;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void TranspositionTable::Put(uint64 key, int nbDups, int nbLosses, int depth)
+{
+    if (nbEntries == 0)
+        return;
+
+    size_t b = (size_t)(key & bucketMask) * 2;
+
+    //the first entry is only replaced by a deeper one (or by the same key), the second one by anything
+    size_t i = b + 1;
+    if (entries[b].depth <= depth + 1 || entries[b].key == key)
+        i = b;
+
+    entries[i].key = key;
+    entries[i].nbDups = nbDups;
+    entries[i].nbLosses = nbLosses;
+    entries[i].depth = depth + 1;
+}
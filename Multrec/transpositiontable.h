@@ -0,0 +1,61 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <cstddef>
+#include "div/define.h"
+
+using namespace std;
+
+
+/**
+ * @brief The TranspositionTable class memoizes the lower bounds computed on states of the reconciliation search,
+ * so that states that are equivalent for the bounds do not compute them again.  States are identified by a 64 bits key
+ * (see MultiGeneReconcilerState::topsHash).  The table has a fixed size, given in bytes, and each key can go in one of
+ * two entries.  The first one keeps the entry with the largest depth, i.e. the one that is the most costly to recompute,
+ * and the second one always keeps the most recent entry.\n
+ * A table is not thread-safe: the parallel search has one per worker.
+ */
+class TranspositionTable
+{
+public:
+    /**
+     * @brief TranspositionTable
+     * @param memoryLimit Maximum size of the table, in bytes.  The table is disabled if this is too small for a single entry.
+     */
+    TranspositionTable(size_t memoryLimit);
+
+    ~TranspositionTable();
+
+    /**
+     * @brief Get
+     * Looks for key in the table.  If it is there, sets nbDups and nbLosses to the values stored with it and returns true.
+     */
+    bool Get(uint64 key, int &nbDups, int &nbLosses);
+
+    /**
+     * @brief Put
+     * Stores the values of key, possibly replacing another key.  depth is the relative importance of the entry.
+     */
+    void Put(uint64 key, int nbDups, int nbLosses, int depth);
+
+private:
+    struct Entry
+    {
+        uint64 key;
+        int nbDups;
+        int nbLosses;
+        int depth;      //depth + 1 of the entry, 0 for an empty entry
+    };
+
+    //two consecutive entries per bucket.  Allocated with calloc, so that the system only gives us the memory we touch:
+    //most searches use a small part of the table.
+    Entry* entries;
+    size_t nbEntries;
+    uint64 bucketMask;
+
+    //a table is too big to be copied
+    TranspositionTable(const TranspositionTable &other);
+    TranspositionTable& operator=(const TranspositionTable &other);
+};
+
+#endif // TRANSPOSITIONTABLE_H
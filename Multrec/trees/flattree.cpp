@@ -0,0 +1,97 @@
+#include "flattree.h"
+
+/**
+See flattree.h for documentation on methods in this class.
+**/
+
+
+FlatTree::FlatTree(Node* root)
+{
+    //depth-first traversal without recursion, since trees can be very deep.  A node gets its pre-order rank when it is
+    //pushed and its id when it is popped, after its children, which are linked to each other as they are popped.
+    class StackEntry
+    {
+    public:
+        Node* node;
+        int childIndex;
+        int preOrderRank;
+        int firstChild;
+        int lastChild;
+    };
+
+    vector<StackEntry> stack;
+    int preOrderCounter = 0;
+
+    StackEntry rootEntry = {root, 0, preOrderCounter++, -1, -1};
+    stack.push_back(rootEntry);
+
+    while (!stack.empty())
+    {
+        StackEntry &entry = stack.back();
+
+        if (entry.childIndex < entry.node->GetNbChildren())
+        {
+            Node* child = entry.node->GetChild(entry.childIndex);
+            entry.childIndex++;
+
+            StackEntry childEntry = {child, 0, preOrderCounter++, -1, -1};
+            stack.push_back(childEntry);
+        }
+        else
+        {
+            int x = nodes.size();
+            ids[entry.node] = x;
+            nodes.push_back(entry.node);
+            parents.push_back(-1);
+            firstChildren.push_back(entry.firstChild);
+            nextSiblings.push_back(-1);
+            depths.push_back(stack.size() - 1);
+            preOrderRanks.push_back(entry.preOrderRank);
+            leafSpecies.push_back(-1);
+
+            for (int c = entry.firstChild; c != -1; c = nextSiblings[c])
+            {
+                parents[c] = x;
+            }
+
+            stack.pop_back();
+
+            if (!stack.empty())
+            {
+                StackEntry &parentEntry = stack.back();
+                if (parentEntry.firstChild == -1)
+                    parentEntry.firstChild = x;
+                else
+                    nextSiblings[parentEntry.lastChild] = x;
+                parentEntry.lastChild = x;
+            }
+        }
+    }
+}
+
+
+
+int FlatTree::GetId(Node* n)
+{
+    unordered_map<Node*, int>::iterator it = ids.find(n);
+    if (it == ids.end())
+        return -1;
+
+    return it->second;
+}
+
+
+
+void FlatTree::SetLeafSpecies(unordered_map<Node*, Node*> &leavesMapping, LCAIndex* speciesIndex)
+{
+    for (int x = 0; x < nodes.size(); x++)
+    {
+        leafSpecies[x] = -1;
+        if (IsLeaf(x))
+        {
+            unordered_map<Node*, Node*>::iterator it = leavesMapping.find(nodes[x]);
+            if (it != leavesMapping.end())
+                leafSpecies[x] = speciesIndex->GetId(it->second);
+        }
+    }
+}
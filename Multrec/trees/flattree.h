@@ -0,0 +1,127 @@
+#ifndef FLATTREE_H
+#define FLATTREE_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "node.h"
+#include "lcaindex.h"
+
+using namespace std;
+
+class Node;
+class LCAIndex;
+
+
+/**
+  A FlatTree is a read-only copy of the structure of a tree, stored in parallel arrays indexed by node id.
+  Ids go from 0 to GetNbNodes() - 1 in post-order (the order of Node::GetPostOrderIterator()), as in LCAIndex: children
+  have smaller ids than their parents, the root has the largest id, and going through the ids in order is a post-order traversal.
+  The children of a node are listed with GetFirstChild and GetNextSibling, in the order of Node::GetChild.
+  GetNode converts an id back to the Node* it was built from, e.g. for output.
+  The tree must not be modified after the FlatTree is built, or the FlatTree must be rebuilt.
+  **/
+class FlatTree
+{
+public:
+    FlatTree(Node* root);
+
+    int GetNbNodes()
+    {
+        return nodes.size();
+    }
+
+    int GetRoot()
+    {
+        return nodes.size() - 1;
+    }
+
+    /**
+      Returns the id of n, or -1 if n is not in the tree.
+      **/
+    int GetId(Node* n);
+
+    Node* GetNode(int id)
+    {
+        return nodes[id];
+    }
+
+    /**
+      Returns the id of the parent of id, -1 for the root
+      **/
+    int GetParent(int id)
+    {
+        return parents[id];
+    }
+
+    /**
+      Returns the id of the first child of id, -1 for a leaf
+      **/
+    int GetFirstChild(int id)
+    {
+        return firstChildren[id];
+    }
+
+    /**
+      Returns the id of the next child of the parent of id, -1 for the last child
+      **/
+    int GetNextSibling(int id)
+    {
+        return nextSiblings[id];
+    }
+
+    bool IsLeaf(int id)
+    {
+        return (firstChildren[id] == -1);
+    }
+
+    /**
+      Returns the number of edges between id and the root
+      **/
+    int GetDepth(int id)
+    {
+        return depths[id];
+    }
+
+    /**
+      Returns the position of id in a pre-order traversal.  Its position in a post-order traversal is id itself.
+      **/
+    int GetPreOrderRank(int id)
+    {
+        return preOrderRanks[id];
+    }
+
+    /**
+      Returns true iff ancestor is an ancestor of x.  As in Node::HasAncestor, a node is its own ancestor.
+      **/
+    bool HasAncestor(int x, int ancestor)
+    {
+        return (preOrderRanks[ancestor] <= preOrderRanks[x] && x <= ancestor);
+    }
+
+    /**
+      Gives each leaf the id in speciesIndex of the species it is mapped to by leavesMapping, or -1 if it is not in leavesMapping.
+      Internal nodes get -1.
+      **/
+    void SetLeafSpecies(unordered_map<Node*, Node*> &leavesMapping, LCAIndex* speciesIndex);
+
+    /**
+      Returns the species id given to id by SetLeafSpecies, -1 for internal nodes or before SetLeafSpecies is called
+      **/
+    int GetLeafSpecies(int id)
+    {
+        return leafSpecies[id];
+    }
+
+private:
+    vector<Node*> nodes;
+    unordered_map<Node*, int> ids;
+    vector<int> parents;
+    vector<int> firstChildren;
+    vector<int> nextSiblings;
+    vector<int> depths;
+    vector<int> preOrderRanks;
+    vector<int> leafSpecies;
+};
+
+#endif // FLATTREE_H
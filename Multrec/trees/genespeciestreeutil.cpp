@@ -25,11 +25,22 @@ GeneSpeciesTreeUtil::GeneSpeciesTreeUtil()
 
 
 
-unordered_map<Node*, Node*> GeneSpeciesTreeUtil::GetLCAMapping(Node *geneTree, Node *speciesTree, unordered_map<Node*, Node*> &geneLeavesSpeciesMapping)
+LCAIndex* GeneSpeciesTreeUtil::GetSpeciesTreeIndex(Node* speciesTree, LCAIndex* speciesTreeIndex)
 {
+    if (speciesTreeIndex || !speciesTree || !speciesTree->GetTreeInfo())
+        return speciesTreeIndex;
+
+    return speciesTree->GetTreeInfo()->GetLCAIndex();
+}
+
+
+
+unordered_map<Node*, Node*> GeneSpeciesTreeUtil::GetLCAMapping(Node *geneTree, Node *speciesTree, unordered_map<Node*, Node*> &geneLeavesSpeciesMapping, LCAIndex* speciesTreeIndex)
+{
+    speciesTreeIndex = GetSpeciesTreeIndex(speciesTree, speciesTreeIndex);
+
     unordered_map<Node*, Node*> lcaMapping;
-    TreeIterator* it = geneTree->GetPostOrderIterator();
-    while (Node* g = it->next())
+    for (Node* g : geneTree->PostOrder())
     {
         if (g->IsLeaf())
         {
@@ -37,40 +48,59 @@ unordered_map<Node*, Node*> GeneSpeciesTreeUtil::GetLCAMapping(Node *geneTree, N
         }
         else
         {
-            vector<Node*> v;
-            for (int i = 0; i < g->GetNbChildren(); i++)
+            lcaMapping[g] = GetSingleNodeLCAMapping(g, speciesTree, lcaMapping, speciesTreeIndex);
+        }
+    }
+
+    return lcaMapping;
+}
+
+
+
+vector<int> GeneSpeciesTreeUtil::GetLCAMapping(FlatTree* geneTree, LCAIndex* speciesTreeIndex)
+{
+    //flat ids are in post-order, so children are mapped before their parent
+    vector<int> lcaMapping(geneTree->GetNbNodes(), -1);
+    for (int g = 0; g < geneTree->GetNbNodes(); g++)
+    {
+        if (geneTree->IsLeaf(g))
+        {
+            lcaMapping[g] = geneTree->GetLeafSpecies(g);
+        }
+        else
+        {
+            int c = geneTree->GetFirstChild(g);
+            int lca = lcaMapping[c];
+            for (c = geneTree->GetNextSibling(c); c != -1; c = geneTree->GetNextSibling(c))
             {
-                v.push_back(lcaMapping[g->GetChild(i)]);
+                lca = speciesTreeIndex->GetLCA(lca, lcaMapping[c]);
             }
-            lcaMapping[g] = speciesTree->FindLCA(v);
+            lcaMapping[g] = lca;
         }
     }
-    geneTree->CloseIterator(it);
 
     return lcaMapping;
 }
 
 
 
-unordered_map<Node*, Node*> GeneSpeciesTreeUtil::GetLCAMapping(Node *geneTree, Node *speciesTree, string geneLabelSeparator, int speciesIndex)
+unordered_map<Node*, Node*> GeneSpeciesTreeUtil::GetLCAMapping(Node *geneTree, Node *speciesTree, string geneLabelSeparator, int speciesIndex, LCAIndex* speciesTreeIndex)
 {
 
     unordered_map<Node*, Node*> m = this->GetGeneSpeciesMappingByLabel(geneTree, speciesTree, geneLabelSeparator, speciesIndex);
 
-    return this->GetLCAMapping(geneTree, speciesTree, m);
+    return this->GetLCAMapping(geneTree, speciesTree, m, speciesTreeIndex);
 }
 
 
 unordered_set<Node*> GeneSpeciesTreeUtil::GetGeneTreeSpecies(Node *geneTree, unordered_map<Node*, Node*> &lcaMapping)
 {
     unordered_set<Node*> species;
-    TreeIterator* it = geneTree->GetPostOrderIterator(true);
-    while (Node* g = it->next())
+    for (Node* g : geneTree->PostOrder(true))
     {
 
         species.insert(lcaMapping[g]);
     }
-    geneTree->CloseIterator(it);
 
     return species;
 }
@@ -91,34 +121,21 @@ vector<Node*> GeneSpeciesTreeUtil::GetGenesSpecies(vector<Node*> genes, unordere
 
 unordered_map<Node*, Node*> GeneSpeciesTreeUtil::GetGeneSpeciesMappingByLabel(Node* geneTree, Node* speciesTree, string separator, int speciesIndex)
 {
-    unordered_map<Node*, Node*> mapping;
+    SpeciesNameIndex speciesNames(speciesTree);
 
-    TreeIterator* it = geneTree->GetPostOrderIterator(true);
-    while (Node* g = it->next())
-    {
-        string lbl = g->GetLabel();
-        vector<string> sz = Util::Split(g->GetLabel(), separator);
+    return GetGeneSpeciesMappingByLabel(geneTree, &speciesNames, separator, speciesIndex);
+}
 
-        if (sz.size() == 0 || (speciesIndex > 0 && sz.size() < speciesIndex - 1))   //there was a bug when speciesIndex = 0
-        {
-            cout<<"Gene label "<<lbl<<" malformed"<<endl<<flush;
-            throw "Gene label " + lbl + " malformed.";
-        }
-        Node* s = speciesTree->GetLeafByLabel(sz[speciesIndex]);
 
-        if (s)
-        {
-            mapping[g] = s;
-        }
-        else
-        {
-            string msg = "Could not find species for gene " + lbl +
-                    "  S=" + NewickLex::ToNewickString(speciesTree);
-            cout<<msg<<endl;
-            throw msg;
-        }
+
+unordered_map<Node*, Node*> GeneSpeciesTreeUtil::GetGeneSpeciesMappingByLabel(Node* geneTree, SpeciesNameIndex* speciesNames, string separator, int speciesIndex)
+{
+    unordered_map<Node*, Node*> mapping;
+
+    for (Node* g : geneTree->PostOrder(true))
+    {
+        mapping[g] = speciesNames->GetGeneSpecies(g, separator, speciesIndex);
     }
-    geneTree->CloseIterator(it);
 
     return mapping;
 }
@@ -131,20 +148,18 @@ Node* GeneSpeciesTreeUtil::CopyTreeWithNodeMapping(Node* tree, unordered_map<Nod
 
     newTree->CopyFrom(tree);
 
-    TreeIterator* it = tree->GetPostOrderIterator();
-    TreeIterator* itNew = newTree->GetPostOrderIterator();
+    PostOrderTraversal::Iterator itNew = newTree->PostOrder().begin();
 
-    while (Node* n = it->next())
+    for (Node* n : tree->PostOrder())
     {
-        Node* n2 = itNew->next();
+        Node* n2 = *itNew;
+        ++itNew;
 
         //n and n2 advance together, so they should point to corresponding nodes
         if (yourMapping.find(n) != yourMapping.end())
             mappingToFill[n2] = yourMapping[n];
 
     }
-    tree->CloseIterator(it);
-    newTree->CloseIterator(itNew);
 
     //debugging
     //GeneSpeciesTreeUtil::Instance()->PrintMapping(newTree, mappingToFill);
@@ -176,8 +191,20 @@ bool GeneSpeciesTreeUtil::HaveCommonSpecies(Node* tree1, Node* tree2, unordered_
 }
 
 
-Node* GeneSpeciesTreeUtil::GetSingleNodeLCAMapping(Node* n, Node* speciesTree, unordered_map<Node*, Node*> &lcaMapping)
+Node* GeneSpeciesTreeUtil::GetSingleNodeLCAMapping(Node* n, Node* speciesTree, unordered_map<Node*, Node*> &lcaMapping, LCAIndex* speciesTreeIndex)
 {
+    speciesTreeIndex = GetSpeciesTreeIndex(speciesTree, speciesTreeIndex);
+
+    if (speciesTreeIndex && n->GetNbChildren() > 0)
+    {
+        Node* lca = lcaMapping[n->GetChild(0)];
+        for (int i = 1; i < n->GetNbChildren(); i++)
+        {
+            lca = speciesTreeIndex->GetLCA(lca, lcaMapping[n->GetChild(i)]);
+        }
+        return lca;
+    }
+
     vector<Node*> v;
     for (int i = 0; i < n->GetNbChildren(); i++)
     {
@@ -190,16 +217,13 @@ Node* GeneSpeciesTreeUtil::GetSingleNodeLCAMapping(Node* n, Node* speciesTree, u
 
 void GeneSpeciesTreeUtil::PrintMapping(Node* tree, unordered_map<Node*, Node*> &mapping)
 {
-    TreeIterator* it = tree->GetPostOrderIterator();
-
-    while (Node* n = it->next())
+    for (Node* n : tree->PostOrder())
     {
         if (mapping[n])
             cout<<n->GetLabel()<<" -> "<<mapping[n]->GetLabel()<<endl;
         else
             cout<<n->GetLabel()<<" -> "<<"NULL"<<endl;
     }
-    tree->CloseIterator(it);
 
 }
 
@@ -210,8 +234,7 @@ vector<Node*> GeneSpeciesTreeUtil::GetNADNodes(Node* g, Node* speciesTree, unord
 {
     vector<Node*> res;
     //TODO : this is dirty and sloooow
-    TreeIterator* it = g->GetPostOrderIterator();
-    while (Node* n = it->next())
+    for (Node* n : g->PostOrder())
     {
         if (!n->IsLeaf())
         {
@@ -225,7 +248,6 @@ vector<Node*> GeneSpeciesTreeUtil::GetNADNodes(Node* g, Node* speciesTree, unord
             }
         }
     }
-    g->CloseIterator(it);
 
     return res;
 }
@@ -237,8 +259,7 @@ int GeneSpeciesTreeUtil::GetDLScore(Node* geneTree, Node* speciesTree, unordered
     int nbDups = 0;
     int nbLosses = 0;
 
-    TreeIterator* it = geneTree->GetPostOrderIterator();
-    while (Node* n = it->next())
+    for (Node* n : geneTree->PostOrder())
     {
         if (!n->IsLeaf())
         {
@@ -277,7 +298,6 @@ int GeneSpeciesTreeUtil::GetDLScore(Node* geneTree, Node* speciesTree, unordered
 
 
     }
-    geneTree->CloseIterator(it);
 
     LASTNBDUPS = nbDups;
     LASTNBLOSSES = nbLosses;
@@ -288,8 +308,7 @@ int GeneSpeciesTreeUtil::GetDLScore(Node* geneTree, Node* speciesTree, unordered
 
 void GeneSpeciesTreeUtil::RelabelGenes(Node* geneTree, string search, string replace)
 {
-    TreeIterator* it = geneTree->GetPostOrderIterator();
-    while (Node* g = it->next())
+    for (Node* g : geneTree->PostOrder())
     {
         /*vector<string> s = Util::Split(g->GetLabel(), separator);
         if (s.size() > geneNameIndex)
@@ -298,15 +317,13 @@ void GeneSpeciesTreeUtil::RelabelGenes(Node* geneTree, string search, string rep
         }*/
         g->SetLabel(Util::ReplaceAll(g->GetLabel(), search, replace));
     }
-    geneTree->CloseIterator(it);
 }
 
 
 
 void GeneSpeciesTreeUtil::RelabelGenesByIndex(Node* geneTree, string separator, int indexToKeep)
 {
-    TreeIterator* it = geneTree->GetPostOrderIterator();
-    while (Node* g = it->next())
+    for (Node* g : geneTree->PostOrder())
     {
         vector<string> s = Util::Split(g->GetLabel(), separator);
         if (s.size() > indexToKeep)
@@ -315,11 +332,10 @@ void GeneSpeciesTreeUtil::RelabelGenesByIndex(Node* geneTree, string separator,
         }
 
     }
-    geneTree->CloseIterator(it);
 }
 
 
-bool GeneSpeciesTreeUtil::IsNodeDup(Node* geneTreeNode, unordered_map<Node*, Node*> &lca_mapping)
+bool GeneSpeciesTreeUtil::IsNodeDup(Node* geneTreeNode, unordered_map<Node*, Node*> &lca_mapping, LCAIndex* speciesTreeIndex)
 {
     if (geneTreeNode->GetNbChildren() <= 1)
         return false;
@@ -339,7 +355,7 @@ bool GeneSpeciesTreeUtil::IsNodeDup(Node* geneTreeNode, unordered_map<Node*, Nod
                 Node* sp1 = lca_mapping[geneTreeNode->GetChild(i)];
                 Node* sp2 = lca_mapping[geneTreeNode->GetChild(j)];
 
-                Node* splca = sp1->FindLCAWith(sp2);
+                Node* splca = (speciesTreeIndex ? speciesTreeIndex->GetLCA(sp1, sp2) : sp1->FindLCAWith(sp2));
 
                 if (splca == sp1 || splca == sp2)
                     return false;
@@ -374,12 +390,10 @@ void GeneSpeciesTreeUtil::PruneSpeciesTreeFromLCAMapping(Node* speciesTree, Node
 {
     set<Node*> speciesToKeep;
 
-    TreeIterator* it = geneTree->GetPostOrderIterator(true);
-    while (Node* leaf = it->next())
+    for (Node* leaf : geneTree->PostOrder(true))
     {
         speciesToKeep.insert(lca_mapping[leaf]);
     }
-    geneTree->CloseIterator(it);
 
     PruneSpeciesTree(speciesTree, speciesToKeep);
 }
@@ -395,12 +409,13 @@ void GeneSpeciesTreeUtil::PruneSpeciesTree(Node* speciesTree, set<Node*> species
 
 
 vector<Node*> GeneSpeciesTreeUtil::GetGeneTreeHighestSpeciations(Node* geneTree, Node* speciesTree,
-                                             unordered_map<Node*, Node*> lca_mapping)
+                                             unordered_map<Node*, Node*> lca_mapping, LCAIndex* speciesTreeIndex)
 {
     vector<Node*> specs;
+    speciesTreeIndex = GetSpeciesTreeIndex(speciesTree, speciesTreeIndex);
 
     //root of gene tree is a spec => return it
-    if (!GeneSpeciesTreeUtil::Instance()->IsNodeDup(geneTree, lca_mapping))
+    if (!GeneSpeciesTreeUtil::Instance()->IsNodeDup(geneTree, lca_mapping, speciesTreeIndex))
     {
         specs.push_back(geneTree);
     }
@@ -409,7 +424,7 @@ vector<Node*> GeneSpeciesTreeUtil::GetGeneTreeHighestSpeciations(Node* geneTree,
     {
         for (int i = 0; i < geneTree->GetNbChildren(); i++)
         {
-            vector<Node*> ch_specs = GetGeneTreeHighestSpeciations(geneTree->GetChild(i), speciesTree, lca_mapping);
+            vector<Node*> ch_specs = GetGeneTreeHighestSpeciations(geneTree->GetChild(i), speciesTree, lca_mapping, speciesTreeIndex);
             specs.insert(specs.end(), ch_specs.begin(), ch_specs.end());
         }
     }
@@ -431,9 +446,7 @@ void GeneSpeciesTreeUtil::LabelInternalNodesUniquely(vector<Node*> trees)
     //counter starts at lowest available integer
     for (int t = 0; t < trees.size(); t++)
     {
-        TreeIterator* it = trees[t]->GetPostOrderIterator(true);
-
-        while (Node* n = it->next())
+        for (Node* n : trees[t]->PostOrder(true))
         {
             if (Util::IsInt(n->GetLabel()))
             {
@@ -443,14 +456,11 @@ void GeneSpeciesTreeUtil::LabelInternalNodesUniquely(vector<Node*> trees)
                     cpt = q + 1;
             }
         }
-        trees[t]->CloseIterator(it);
     }
 
     for (int t = 0; t < trees.size(); t++)
     {
-        TreeIterator* it = trees[t]->GetPostOrderIterator();
-
-        while (Node* n = it->next())
+        for (Node* n : trees[t]->PostOrder())
         {
             if (!n->IsLeaf())
             {
@@ -464,22 +474,17 @@ void GeneSpeciesTreeUtil::LabelInternalNodesUniquely(vector<Node*> trees)
                 cpt++;
             }
         }
-
-        trees[t]->CloseIterator(it);
     }
 }
 
 
 void GeneSpeciesTreeUtil::LabelInternalNodesWithLCAMapping(Node* geneTree, Node* speciesTree, unordered_map<Node*, Node*> lca_mapping)
 {
-    TreeIterator* it = geneTree->GetPostOrderIterator();
-    while (Node* g = it->next())
+    for (Node* g : geneTree->PostOrder())
     {
         if (!g->IsLeaf())
             g->SetLabel(lca_mapping[g]->GetLabel());
     }
-
-    geneTree->CloseIterator(it);
 }
 
 
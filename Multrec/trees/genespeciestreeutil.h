@@ -3,6 +3,9 @@
 
 #include "trees/node.h"
 #include "trees/newicklex.h"
+#include "trees/lcaindex.h"
+#include "trees/flattree.h"
+#include "trees/speciesnameindex.h"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -28,21 +31,41 @@ public:
     int LASTNBDUPS;
     int LASTNBLOSSES;
 
-    unordered_map<Node*, Node*> GetLCAMapping(Node *geneTree, Node *speciesTree, unordered_map<Node*, Node*> &geneLeavesSpeciesMapping);
+    /**
+     * @brief GetLCAMapping
+     * The optional speciesTreeIndex must have been built on speciesTree.  When given, the lcas are computed in constant time with it.
+     * Otherwise, the index of the TreeInfo of speciesTree is used if it has one, and the lcas are found by walking up the species tree if not.
+     * The same holds for the other methods taking an LCAIndex.
+     */
+    unordered_map<Node*, Node*> GetLCAMapping(Node *geneTree, Node *speciesTree, unordered_map<Node*, Node*> &geneLeavesSpeciesMapping, LCAIndex* speciesTreeIndex = NULL);
+
+    unordered_map<Node*, Node*> GetLCAMapping(Node *geneTree, Node *speciesTree, string geneLabelSeparator, int speciesIndex, LCAIndex* speciesTreeIndex = NULL);
 
-    unordered_map<Node*, Node*> GetLCAMapping(Node *geneTree, Node *speciesTree, string geneLabelSeparator, int speciesIndex);
+    /**
+     * @brief GetLCAMapping
+     * Same as above on a FlatTree whose leaves have their species set (see FlatTree::SetLeafSpecies), in one pass over its arrays.
+     * Returns the species id in speciesTreeIndex of each gene node, indexed by flat id.
+     */
+    vector<int> GetLCAMapping(FlatTree* geneTree, LCAIndex* speciesTreeIndex);
 
     unordered_set<Node*> GetGeneTreeSpecies(Node *geneTree, unordered_map<Node*, Node*> &lcaMapping);
 
     vector<Node*> GetGenesSpecies(vector<Node*> genes, unordered_map<Node*, Node*> &lcaMapping);
 
+    /**
+     * @brief GetGeneSpeciesMappingByLabel
+     * Maps each leaf of geneTree to the leaf of speciesTree named at position speciesIndex of its label, once split by separator.
+     * The second version uses a SpeciesNameIndex built on the species tree, so that the index is built only once for many gene trees.
+     */
     unordered_map<Node*, Node*> GetGeneSpeciesMappingByLabel(Node* geneTree, Node* speciesTree, string separator = "_", int speciesIndex = 0);
 
+    unordered_map<Node*, Node*> GetGeneSpeciesMappingByLabel(Node* geneTree, SpeciesNameIndex* speciesNames, string separator = "_", int speciesIndex = 0);
+
     Node* CopyTreeWithNodeMapping(Node* tree, unordered_map<Node*, Node*> &yourMapping, unordered_map<Node*,Node*> &mappingToFill);
 
     bool HaveCommonSpecies(Node* tree1, Node* tree2, unordered_map<Node*, Node*> &mapping);
 
-    Node* GetSingleNodeLCAMapping(Node* n, Node* speciesTree, unordered_map<Node*, Node*> &lcaMapping);
+    Node* GetSingleNodeLCAMapping(Node* n, Node* speciesTree, unordered_map<Node*, Node*> &lcaMapping, LCAIndex* speciesTreeIndex = NULL);
 
     void PrintMapping(Node* g, unordered_map<Node*, Node*> &mapping);
 
@@ -63,21 +86,26 @@ public:
     void PruneSpeciesTree(Node* speciesTree, set<Node*> speciesToKeep);
 
     vector<Node*> GetGeneTreeHighestSpeciations(Node* geneTree, Node* speciesTree,
-                                                 unordered_map<Node*, Node*> lca_mapping);
+                                                 unordered_map<Node*, Node*> lca_mapping, LCAIndex* speciesTreeIndex = NULL);
 
     /**
      * @brief IsNodeDup Checks if parsimony would infer a duplication at geneTreeNode.  Works in the non-binary case.
      * @param geneTreeNode
      * @param lca_mapping
+     * @param speciesTreeIndex Optional index on the species tree, used for the lca queries in the non-binary case
      * @return
      */
-    bool IsNodeDup(Node* geneTreeNode, unordered_map<Node*, Node*> &lca_mapping);
+    bool IsNodeDup(Node* geneTreeNode, unordered_map<Node*, Node*> &lca_mapping, LCAIndex* speciesTreeIndex = NULL);
 
     void LabelInternalNodesWithLCAMapping(Node* geneTree, Node* speciesTree, unordered_map<Node*, Node*> lca_mapping);
     void LabelInternalNodesUniquely(Node* tree);
     void LabelInternalNodesUniquely(vector<Node*> trees);
 
     string GetPrunedSpeciesTreeNewick(string gcontent, string scontent);
+
+private:
+    //returns speciesTreeIndex if not NULL, otherwise the LCAIndex of the TreeInfo of speciesTree, or NULL if it has none
+    LCAIndex* GetSpeciesTreeIndex(Node* speciesTree, LCAIndex* speciesTreeIndex);
 };
 
 #endif // GENESPECIESTREEUTIL_H
@@ -0,0 +1,124 @@
+#include "lcaindex.h"
+
+#include "treeiterator.h"
+
+/**
+See lcaindex.h for documentation on methods in this class.
+**/
+
+
+LCAIndex::LCAIndex(Node* root)
+{
+    for (Node* n : root->PostOrder())
+    {
+        ids[n] = nodes.size();
+        nodes.push_back(n);
+    }
+
+    int nbNodes = nodes.size();
+    parents.resize(nbNodes, -1);
+    depths.resize(nbNodes, 0);
+    preOrderNumbers.resize(nbNodes, 0);
+    firstOccurrences.resize(nbNodes, 0);
+
+    //parents come after their children, so we go from the root down.  The root is the last node (the tree may be a subtree).
+    for (int x = nbNodes - 2; x >= 0; x--)
+    {
+        parents[x] = ids[nodes[x]->GetParent()];
+        depths[x] = depths[parents[x]] + 1;
+    }
+
+    //pre-order and Euler tour, without recursion since trees can be very deep.
+    //Each stack entry is a node and the index of the next child to visit.
+    vector< pair<int, int> > stack;
+    stack.push_back(make_pair(nbNodes - 1, 0));
+    int preOrderCounter = 0;
+    preOrderNumbers[nbNodes - 1] = preOrderCounter++;
+    firstOccurrences[nbNodes - 1] = 0;
+    eulerTour.push_back(nbNodes - 1);
+
+    while (!stack.empty())
+    {
+        int x = stack.back().first;
+        int childIndex = stack.back().second;
+
+        if (childIndex < nodes[x]->GetNbChildren())
+        {
+            stack.back().second++;
+
+            int child = ids[nodes[x]->GetChild(childIndex)];
+            preOrderNumbers[child] = preOrderCounter++;
+            firstOccurrences[child] = eulerTour.size();
+            eulerTour.push_back(child);
+            stack.push_back(make_pair(child, 0));
+        }
+        else
+        {
+            stack.pop_back();
+            if (!stack.empty())
+                eulerTour.push_back(stack.back().first);
+        }
+    }
+
+    int tourSize = eulerTour.size();
+    logs.resize(tourSize + 1, 0);
+    for (int i = 2; i <= tourSize; i++)
+    {
+        logs[i] = logs[i / 2] + 1;
+    }
+
+    sparseTable.push_back(eulerTour);
+    for (int k = 1; (1 << k) <= tourSize; k++)
+    {
+        vector<int> &prev = sparseTable[k - 1];
+        vector<int> level(tourSize - (1 << k) + 1);
+        for (int i = 0; i < level.size(); i++)
+        {
+            int a = prev[i];
+            int b = prev[i + (1 << (k - 1))];
+            level[i] = (depths[a] <= depths[b] ? a : b);
+        }
+        sparseTable.push_back(level);
+    }
+}
+
+
+int LCAIndex::GetId(Node* n)
+{
+    unordered_map<Node*, int>::iterator it = ids.find(n);
+    if (it == ids.end())
+        return -1;
+    return it->second;
+}
+
+
+int LCAIndex::GetLCA(int x, int y)
+{
+    if (HasAncestor(x, y))
+        return y;
+    if (HasAncestor(y, x))
+        return x;
+
+    int i = firstOccurrences[x];
+    int j = firstOccurrences[y];
+    if (i > j)
+        swap(i, j);
+
+    int k = logs[j - i + 1];
+    int a = sparseTable[k][i];
+    int b = sparseTable[k][j - (1 << k) + 1];
+
+    return (depths[a] <= depths[b] ? a : b);
+}
+
+
+Node* LCAIndex::GetLCA(Node* n1, Node* n2)
+{
+    return nodes[GetLCA(ids[n1], ids[n2])];
+}
+
+
+bool LCAIndex::HasAncestor(Node* n, Node* ancestor)
+{
+    return HasAncestor(ids[n], ids[ancestor]);
+}
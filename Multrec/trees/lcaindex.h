@@ -0,0 +1,97 @@
+#ifndef LCAINDEX_H
+#define LCAINDEX_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "node.h"
+
+using namespace std;
+
+class Node;
+
+
+/**
+  An LCAIndex is built once on a tree, and then answers lca and ancestor queries in constant time, for any depth and any degree.
+  Every node of the tree gets an id from 0 to GetNbNodes() - 1, given in post-order
+  (the order of Node::GetPostOrderIterator()), so that children have smaller ids than their parents and the root has the largest id.
+  Queries can be made on ids or on nodes.  The tree must not be modified after the index is built, or the index must be rebuilt.\n
+  The lca uses a range minimum query on the depths of the Euler tour of the tree, answered with a sparse table
+  (O(n log n) space).  Ancestor tests compare the pre-order and post-order numbers of the nodes.
+  **/
+class LCAIndex
+{
+public:
+    LCAIndex(Node* root);
+
+    int GetNbNodes()
+    {
+        return nodes.size();
+    }
+
+    /**
+      Returns the id of n, or -1 if n is not in the tree.
+      **/
+    int GetId(Node* n);
+
+    Node* GetNode(int id)
+    {
+        return nodes[id];
+    }
+
+    /**
+      Returns the id of the parent of id, -1 for the root
+      **/
+    int GetParent(int id)
+    {
+        return parents[id];
+    }
+
+    /**
+      Returns the number of edges between id and the root
+      **/
+    int GetDepth(int id)
+    {
+        return depths[id];
+    }
+
+    /**
+      Returns the id of the lowest common ancestor of x and y
+      **/
+    int GetLCA(int x, int y);
+
+    Node* GetLCA(Node* n1, Node* n2);
+
+    /**
+      Returns true iff ancestor is an ancestor of x.  As in Node::HasAncestor, a node is its own ancestor.
+      **/
+    bool HasAncestor(int x, int ancestor)
+    {
+        return (preOrderNumbers[ancestor] <= preOrderNumbers[x] && x <= ancestor);
+    }
+
+    bool HasAncestor(Node* n, Node* ancestor);
+
+private:
+    vector<Node*> nodes;
+    unordered_map<Node*, int> ids;
+    vector<int> parents;
+    vector<int> depths;
+
+    //position of each node in a pre-order traversal.  Since ids are post-order positions, the descendants of a node x
+    //are the nodes y with preOrderNumbers[x] <= preOrderNumbers[y] and y <= x.
+    vector<int> preOrderNumbers;
+
+    //the Euler tour lists the nodes (by id) each time the traversal goes through them, 2n - 1 entries.
+    //firstOccurrences[id] is the first position of id in the tour.
+    vector<int> eulerTour;
+    vector<int> firstOccurrences;
+
+    //sparseTable[k][i] is the node of smallest depth among eulerTour[i .. i + 2^k - 1]
+    vector< vector<int> > sparseTable;
+
+    //floor of log2(i), for i up to the size of the Euler tour
+    vector<int> logs;
+};
+
+#endif // LCAINDEX_H
@@ -4,9 +4,9 @@
 
 
 
-Node* NewickLex::ParseNewickString(string& str, bool maintainTreeInfo)
+Node* NewickLex::ParseNewickString(string& str, bool maintainTreeInfo, NodeForest* forest)
 {
-    Node* root = new Node(maintainTreeInfo);
+    Node* root = (forest ? forest->CreateTree(maintainTreeInfo) : new Node(maintainTreeInfo));
     int pos = str.find_last_of(')');
     int lastcolonpos = str.find_last_of(';');
 
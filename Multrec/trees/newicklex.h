@@ -3,6 +3,7 @@
 
 #include <string>
 #include "node.h"
+#include "nodeforest.h"
 #include "div/util.h"
 
 #include <iostream>
@@ -11,6 +12,7 @@
 using namespace std;
 
 class Node;
+class NodeForest;
 
 class NewickLex
 {
@@ -26,9 +28,10 @@ public:
       User has to delete returned value. \n
       Set maintainTreeInfo = true if you want each node of the tree to hold a treeInfo,
       which mainly serves to accelerate LCA finding and searching a node by label. \n
-      See Node constructor and TreeInfo class for more information.
+      See Node constructor and TreeInfo class for more information. \n
+      If forest is not NULL, the tree is created in it, and the forest deletes it instead of the user.
     **/
-    static Node* ParseNewickString(string& str, bool maintainTreeInfo = false);
+    static Node* ParseNewickString(string& str, bool maintainTreeInfo = false, NodeForest* forest = NULL);
 
     /**
       Converts a tree to a Newick string, naming the nodes using Node::GetLabel().
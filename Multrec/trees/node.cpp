@@ -1,4 +1,7 @@
 #include "node.h"
+#include "nodeforest.h"
+
+#include <algorithm>
 
 
 
@@ -26,6 +29,8 @@ Node::Node(bool maintainTreeInfo)
     this->pathBits = 0;
     this->branchLength = 0.0;
     this->depth = -1;
+    this->forest = NULL;
+    this->childIndex = -1;
 
     if (maintainTreeInfo)
     {
@@ -46,6 +51,8 @@ Node::Node(TreeInfo* treeInfo)
     this->depth = -1;
     this->parent = NULL;
     this->treeInfo = treeInfo;
+    this->forest = NULL;
+    this->childIndex = -1;
     this->nodeInfo = NULL;
     this->state = 0;
     this->pathBits = 0;
@@ -56,9 +63,11 @@ Node::Node(TreeInfo* treeInfo)
 
 Node::~Node()
 {
+    //the children that belong to a forest are destroyed by the forest
     for (int i = 0; i < children.size(); i++)
     {
-        delete children[i];
+        if (!children[i]->forest)
+            delete children[i];
     }
     children.clear();
 
@@ -73,7 +82,10 @@ Node::~Node()
 Node* Node::AddChild()
 {
     Node* n = this->CreateNode(treeInfo);
-    this->AddSubTree(n);
+    //AddSubTree refuses nodes with a tree info, but n already belongs to this tree
+    children.push_back(n);
+    n->SetParent(this);
+    n->childIndex = children.size() - 1;
 
     if (treeInfo)
         treeInfo->OnNodeInserted(n, this->children.size() - 1);
@@ -83,6 +95,9 @@ Node* Node::AddChild()
 
 Node* Node::CreateNode(TreeInfo* treeInfo)
 {
+    if (forest)
+        return forest->AllocateNode(treeInfo);
+
     return new Node(treeInfo);
 }
 
@@ -97,6 +112,7 @@ Node* Node::InsertChild(int pos)
     Node* n = this->CreateNode(treeInfo);
     children.insert(it + pos, n);
     n->SetParent(this);
+    UpdateChildIndices(pos);
 
 
     if (treeInfo)
@@ -136,40 +152,49 @@ string Node::GetLabel()
 
 Node* Node::GetLeftSibling()
 {
-    if (this->IsRoot())
+    int index = GetChildIndex();
+    if (index <= 0)
         return NULL;
-    int pindex = -1;
 
-    //this pretty much sucks, having to iterate through all parent's children to find "this"
-    for (int i = 0; i < this->parent->GetNbChildren(); i++)
-    {
-        if (parent->GetChild(i) == this)
-            pindex = i;
-    }
+    return parent->children[index - 1];
+}
 
-    if (pindex == 0)
+Node* Node::GetRightSibling()
+{
+    int index = GetChildIndex();
+    if (index == -1 || index == parent->children.size() - 1)
         return NULL;
 
-    return parent->GetChild(pindex -1);
+    return parent->children[index + 1];
 }
 
-Node* Node::GetRightSibling()
+
+int Node::GetChildIndex()
 {
     if (this->IsRoot())
-        return NULL;
-    int pindex = -1;
+        return -1;
 
-    //this pretty much sucks, having to iterate through all parent's children to find "this"
-    for (int i = 0; i < this->parent->GetNbChildren(); i++)
+    //a node given a parent with SetParent only is not at the position it believes
+    if (childIndex < 0 || childIndex >= parent->children.size() || parent->children[childIndex] != this)
     {
-        if (parent->GetChild(i) == this)
-            pindex = i;
+        childIndex = -1;
+        for (int i = 0; i < parent->children.size() && childIndex == -1; i++)
+        {
+            if (parent->children[i] == this)
+                childIndex = i;
+        }
     }
 
-    if (pindex == parent->GetNbChildren() - 1)
-        return NULL;
+    return childIndex;
+}
 
-    return parent->GetChild(pindex + 1);
+
+void Node::UpdateChildIndices(int from)
+{
+    for (int i = from; i < children.size(); i++)
+    {
+        children[i]->childIndex = i;
+    }
 }
 
 
@@ -188,6 +213,18 @@ TreeIterator* Node::GetPreOrderIterator(bool leavesOnly)
     return it;
 }
 
+
+PostOrderTraversal Node::PostOrder(bool leavesOnly)
+{
+    return PostOrderTraversal(this, leavesOnly);
+}
+
+
+PreOrderTraversal Node::PreOrder(bool leavesOnly)
+{
+    return PreOrderTraversal(this, leavesOnly);
+}
+
 void Node::CloseIterator(TreeIterator* it)
 {
     delete it;
@@ -269,6 +306,7 @@ void Node::AddSubTree(Node* n)
 
     this->children.push_back(n);
     n->SetParent(this);
+    n->childIndex = children.size() - 1;
 
 }
 
@@ -294,25 +332,46 @@ void Node::DeleteTreeInfo()
 }
 
 
-void Node::RemoveChild(Node* node)
+void Node::DeleteNode(Node* node)
 {
-    vector<Node*>::iterator it = this->children.begin();
+    if (!node->forest)
+        delete node;
+    else if (node->parent == NULL)
+        node->treeInfo = NULL;  //the node is out of its tree, which keeps its TreeInfo
+}
 
-    while (it != this->children.end())
-    {
-        if ((*it) == node)
-        {
-            it = children.erase(it);
 
-            if (treeInfo)
-                treeInfo->OnNodeDeleted();
-        }
-        else
-        {
-            it++;
-        }
+NodeForest* Node::GetForest()
+{
+    return forest;
+}
+
+
+void Node::RemoveChild(Node* node)
+{
+    //the position of node is only known if this is its parent
+    int index = -1;
+    if (node->parent == this)
+    {
+        index = node->GetChildIndex();
+    }
+    else
+    {
+        vector<Node*>::iterator it = find(children.begin(), children.end(), node);
+        if (it != children.end())
+            index = it - children.begin();
     }
 
+    if (index == -1)
+        return;
+
+    children.erase(children.begin() + index);
+    if (node->parent == this)
+        node->childIndex = -1;
+    UpdateChildIndices(index);
+
+    if (treeInfo)
+        treeInfo->OnNodeDeleted();
 }
 
 
@@ -323,6 +382,7 @@ void Node::RemoveChildren(bool setParentToNullOnChildren)
         for (int i = 0; i < children.size(); i++)
         {
             this->children[i]->SetParent(NULL);
+            this->children[i]->childIndex = -1;
         }
     }
     children.clear();
@@ -499,10 +559,8 @@ double Node::GetBranchLength()
 
 Node* Node::GetNodeWithLabel(string lbl, bool ignoreCase)
 {
-    TreeIterator* it = this->GetPostOrderIterator();
-
     Node* found = NULL;
-    while (Node* n = it->next())
+    for (Node* n : this->PostOrder())
     {
         if (ignoreCase)
         {
@@ -521,7 +579,6 @@ Node* Node::GetNodeWithLabel(string lbl, bool ignoreCase)
             }
         }
     }
-    this->CloseIterator(it);
 
     return found;
 }
@@ -530,13 +587,10 @@ Node* Node::GetNodeWithLabel(string lbl, bool ignoreCase)
 set<Node*> Node::GetLeafSet()
 {
     set<Node*> leaves;
-    TreeIterator* it = this->GetPostOrderIterator(true);
-
-    while (Node* n = it->next())
+    for (Node* n : this->PostOrder(true))
     {
         leaves.insert(n);
     }
-    this->CloseIterator(it);
 
     return leaves;
 
@@ -546,13 +600,10 @@ set<Node*> Node::GetLeafSet()
 vector<Node*> Node::GetLeafVector()
 {
     vector<Node*> leaves;
-    TreeIterator* it = this->GetPostOrderIterator(true);
-
-    while (Node* n = it->next())
+    for (Node* n : this->PostOrder(true))
     {
         leaves.push_back(n);
     }
-    this->CloseIterator(it);
 
     return leaves;
 
@@ -567,17 +618,7 @@ Node* Node::InsertParentWith(Node* sibling)
     if (!prevParent)
         return NULL;
 
-    int sindex = -1;
-    for (int i = 0; i < prevParent->GetNbChildren(); i++)
-    {
-        if (prevParent->GetChild(i) == sibling)
-        {
-            sindex = i;
-            break;
-        }
-    }
-
-    if (sindex == -1)
+    if (sibling->GetParent() != prevParent || sibling->GetChildIndex() == -1)
         return NULL;
 
     Node* newParent = prevParent->AddChild();
@@ -632,12 +673,10 @@ vector<Node*> Node::GetChildrenVector()
 vector<Node*> Node::GetPostOrderedNodes()
 {
     vector<Node*> v;
-    TreeIterator* it = this->GetPostOrderIterator();
-    while (Node* n = it->next())
+    for (Node* n : this->PostOrder())
     {
         v.push_back(n);
     }
-    this->CloseIterator(it);
 
     return v;
 }
@@ -742,13 +781,10 @@ Node* Node::GetLeafByLabel(string label)
 set<string> Node::GetLeafLabels()
 {
     set<string> labels;
-    TreeIterator* it = this->GetPostOrderIterator(true);
-
-    while (Node* n = it->next())
+    for (Node* n : this->PostOrder(true))
     {
         labels.insert(n->GetLabel());
     }
-    this->CloseIterator(it);
 
     return labels;
 }
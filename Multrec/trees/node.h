@@ -12,6 +12,9 @@
 
 class TreeIterator;
 class TreeInfo;
+class NodeForest;
+class PostOrderTraversal;
+class PreOrderTraversal;
 
 using namespace std;
 
@@ -35,6 +38,8 @@ public:
   The leaves have no children.
   Only the root should be created/destroyed by user.  The creation/destruction of descendents is handled by
   the tree (descendents are deleted when the root is deleted). \n
+  Trees can also be created in a NodeForest, which allocates their nodes in blocks and destroys them all at once.
+  The nodes of such trees must not be deleted by the user (see NodeForest). \n
   Nodes can have a TreeInfo or not.  Recommended is NOT.  Refer to the Node constructor, and to the TreeInfo class for information.
   **/
 class Node
@@ -47,6 +52,13 @@ protected:
 
     TreeInfo* treeInfo;
 
+    //the forest that owns the node, or NULL if it was allocated with new
+    NodeForest* forest;
+
+    //position of the node among the children of its parent, -1 if it has none.  Kept up to date by the methods that change
+    //the children of a node, so that siblings are found in constant time.
+    int childIndex;
+
     int depth;
     uint64 pathBits;
     int state;
@@ -62,6 +74,11 @@ protected:
 
 
     Node* SetAsRootInCopy(Node* ignore);
+
+    //sets the childIndex of the children from position from onwards
+    void UpdateChildIndices(int from);
+
+    friend class NodeForest;
 public:
     /**
       Set maintainTreeInfo = true if you want every node of the tree to
@@ -102,17 +119,20 @@ public:
     Node* GetParent();
 
     /**
-      Get previous child of node's parent, or NULL if node is the first child.\n
-      Watch out : this method may need to go through the whole vector of parent's children
+      Get previous child of node's parent, or NULL if node is the first child.  Takes constant time.
       **/
     Node* GetLeftSibling();
 
     /**
-      Get next child of node's parent, or NULL if node is the last child.\n
-      Watch out : this method may need to go through the whole vector of parent's children
+      Get next child of node's parent, or NULL if node is the last child.  Takes constant time.
       **/
     Node* GetRightSibling();
 
+    /**
+      Returns the position of the node among the children of its parent, or -1 if it is the root.  Takes constant time.
+      **/
+    int GetChildIndex();
+
 
     /**
       Get an iterator that traverses the node and its descendants is post-order.
@@ -150,6 +170,25 @@ public:
     TreeIterator* GetPreOrderIterator(bool leavesOnly = false);
 
 
+    /**
+      Returns a post-order traversal of the node and its descendants, for a range-based for loop.
+      Set leavesOnly = true to only go through leaves.  Nothing needs to be closed, and no heap allocation is made
+      (see PostOrderTraversal).  Prefer it to GetPostOrderIterator when the tree is not modified during the traversal.
+      @code
+      for (Node* n : my_node->PostOrder())
+      {
+        //do fascinating stuff
+      }
+      @endcode
+      **/
+    PostOrderTraversal PostOrder(bool leavesOnly = false);
+
+    /**
+      Returns a pre-order traversal of the node and its descendants, for a range-based for loop.  See PostOrder.
+      **/
+    PreOrderTraversal PreOrder(bool leavesOnly = false);
+
+
     /**
       Closes an iterator previously created by GetPostOrderIterator or GetPreOrderIterator.\n
       Must be called to clear iterator from memory !
@@ -211,6 +250,17 @@ public:
 
     void DeleteTreeInfo();
 
+    /**
+      Deletes node and its descendants, unless node belongs to a NodeForest, in which case the forest destroys them
+      when it is destroyed.  Use this instead of delete on nodes that may come from a forest.
+      **/
+    static void DeleteNode(Node* node);
+
+    /**
+      Returns the NodeForest that owns the node, or NULL if the node was allocated with new.
+      **/
+    NodeForest* GetForest();
+
     /**
       Remove a node that belongs to the children of the node.  This child DOES NOT get deleted, and has its parent set to NULL.
       Since the caller has access to the node, he is expected to delete it.
@@ -351,4 +401,7 @@ public:
 
 bool Node__RestrictToLeafsetFunction(Node* n, void *arg);
 
+//the traversals returned by Node::PostOrder and Node::PreOrder need the complete Node class
+#include "treetraversal.h"
+
 #endif // NODE_H
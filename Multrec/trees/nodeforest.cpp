@@ -0,0 +1,73 @@
+#include "nodeforest.h"
+
+#include <new>
+
+
+NodeForest::NodeForest(int nbNodesPerBlock)
+{
+    this->nbNodesPerBlock = max(1, nbNodesPerBlock);
+    this->nbInLastBlock = this->nbNodesPerBlock;
+}
+
+
+
+NodeForest::~NodeForest()
+{
+    //nodes of a forest do not delete their children, so every node is destroyed exactly once here, block by block
+    for (int b = 0; b < blocks.size(); b++)
+    {
+        int nbUsed = (b == blocks.size() - 1 ? nbInLastBlock : nbNodesPerBlock);
+        for (int i = 0; i < nbUsed; i++)
+        {
+            blocks[b][i].~Node();
+        }
+
+        ::operator delete(blocks[b]);
+    }
+    blocks.clear();
+}
+
+
+
+Node* NodeForest::CreateTree(bool maintainTreeInfo)
+{
+    Node* root = new (GetFreeSpace()) Node(maintainTreeInfo);
+    root->forest = this;
+    nbInLastBlock++;
+
+    return root;
+}
+
+
+
+int NodeForest::GetNbNodes()
+{
+    if (blocks.size() == 0)
+        return 0;
+
+    return (blocks.size() - 1) * nbNodesPerBlock + nbInLastBlock;
+}
+
+
+
+Node* NodeForest::AllocateNode(TreeInfo* treeInfo)
+{
+    Node* n = new (GetFreeSpace()) Node(treeInfo);
+    n->forest = this;
+    nbInLastBlock++;
+
+    return n;
+}
+
+
+
+void* NodeForest::GetFreeSpace()
+{
+    if (nbInLastBlock == nbNodesPerBlock)
+    {
+        blocks.push_back((Node*)::operator new(nbNodesPerBlock * sizeof(Node)));
+        nbInLastBlock = 0;
+    }
+
+    return &blocks.back()[nbInLastBlock];
+}
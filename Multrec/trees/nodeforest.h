@@ -0,0 +1,57 @@
+#ifndef NODEFOREST_H
+#define NODEFOREST_H
+
+#include <vector>
+
+#include "node.h"
+
+using namespace std;
+
+class Node;
+class TreeInfo;
+
+
+/**
+  A NodeForest owns the nodes of a set of trees, and allocates them in contiguous blocks instead of one by one with new.
+  Trees are created with CreateTree (or NewickLex::ParseNewickString), and the nodes added to them with Node::AddChild
+  or Node::InsertChild are allocated in the same forest.  The Node API works as usual on these trees, except that their nodes
+  must NOT be deleted by the user: the forest destroys all of them at once when it is destroyed.
+  A node removed from a tree (e.g. by TreeIterator::DeleteCurrent) stays in memory until then.
+  **/
+class NodeForest
+{
+public:
+    /**
+      nbNodesPerBlock is the number of nodes allocated at once when the forest runs out of space.
+      **/
+    NodeForest(int nbNodesPerBlock = 4096);
+
+    ~NodeForest();
+
+    /**
+      Creates the root of a new tree in the forest.  See the Node constructor for maintainTreeInfo.
+      **/
+    Node* CreateTree(bool maintainTreeInfo = false);
+
+    /**
+      Returns the number of nodes allocated in the forest.
+      **/
+    int GetNbNodes();
+
+private:
+    friend class Node;
+
+    //allocates a node in the last block, or in a new block if it is full
+    Node* AllocateNode(TreeInfo* treeInfo);
+
+    //returns the address of the next free node, adding a block if needed.  The node is counted once it is constructed.
+    void* GetFreeSpace();
+
+    vector<Node*> blocks;
+    int nbNodesPerBlock;
+
+    //number of nodes used in the last block
+    int nbInLastBlock;
+};
+
+#endif // NODEFOREST_H
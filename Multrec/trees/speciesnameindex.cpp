@@ -0,0 +1,74 @@
+#include "speciesnameindex.h"
+
+#include "newicklex.h"
+
+#include <iostream>
+
+/**
+See speciesnameindex.h for documentation on methods in this class.
+**/
+
+
+SpeciesNameIndex::SpeciesNameIndex(Node* speciesTree)
+{
+    this->speciesTree = speciesTree;
+
+    for (Node* s : speciesTree->PostOrder(true))
+    {
+        int symbol = names.Intern(s->GetLabel());
+        if (symbol == leaves.size())
+            leaves.push_back(s);
+    }
+}
+
+
+
+Node* SpeciesNameIndex::GetLeaf(const string &name)
+{
+    int symbol = names.GetSymbol(name);
+    if (symbol == -1)
+        return NULL;
+
+    return leaves[symbol];
+}
+
+
+
+Node* SpeciesNameIndex::GetGeneSpecies(Node* gene, const string &separator, int speciesIndex)
+{
+    const string &lbl = gene->GetLabel();
+
+    //the species name is found in place, between the separators around it
+    size_t start = 0;
+    size_t end = lbl.length();
+    if (separator != "")
+    {
+        for (int i = 0; i < speciesIndex && start != string::npos; i++)
+        {
+            start = lbl.find(separator, start);
+            if (start != string::npos)
+                start += separator.length();
+        }
+
+        if (start == string::npos)
+        {
+            cout<<"Gene label "<<lbl<<" malformed"<<endl<<flush;
+            throw "Gene label " + lbl + " malformed.";
+        }
+
+        end = lbl.find(separator, start);
+        if (end == string::npos)
+            end = lbl.length();
+    }
+
+    int symbol = names.GetSymbol(lbl.c_str() + start, end - start);
+    if (symbol == -1)
+    {
+        string msg = "Could not find species for gene " + lbl +
+                "  S=" + NewickLex::ToNewickString(speciesTree);
+        cout<<msg<<endl;
+        throw msg;
+    }
+
+    return leaves[symbol];
+}
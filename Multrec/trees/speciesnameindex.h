@@ -0,0 +1,47 @@
+#ifndef SPECIESNAMEINDEX_H
+#define SPECIESNAMEINDEX_H
+
+#include <vector>
+#include <string>
+
+#include "node.h"
+#include "div/stringpool.h"
+
+using namespace std;
+
+class Node;
+
+
+/**
+  A SpeciesNameIndex is built once on a species tree, and then finds the species leaf named in a gene label with a single
+  hash probe, without splitting the label into strings.  The leaf labels are interned in a StringPool, and the symbol of a
+  name indexes the leaf that has it.  If several leaves have the same label, the first one in post-order is kept, as in
+  Node::GetLeafByLabel.\n
+  The species tree must not be modified after the index is built.  Lookups only read the index, so the same index can be
+  shared by threads.
+  **/
+class SpeciesNameIndex
+{
+public:
+    SpeciesNameIndex(Node* speciesTree);
+
+    /**
+      Returns the leaf labeled name, or NULL if there is none.
+      **/
+    Node* GetLeaf(const string &name);
+
+    /**
+      Returns the species leaf of a gene, whose label has the species name at position speciesIndex (indexed at 0) once split by
+      separator.  Throws a string if the label has fewer fields, or if no species leaf has that name.
+      **/
+    Node* GetGeneSpecies(Node* gene, const string &separator, int speciesIndex);
+
+private:
+    Node* speciesTree;
+    StringPool names;
+
+    //leaf having the name of each symbol of names
+    vector<Node*> leaves;
+};
+
+#endif // SPECIESNAMEINDEX_H
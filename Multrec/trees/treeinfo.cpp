@@ -1,9 +1,19 @@
 #include "treeinfo.h"
+#include "lcaindex.h"
 
 TreeInfo::TreeInfo(Node* root)
 {
     this->root = root;
     this->degree = 1;
+    this->lcaIndex = NULL;
+    this->lcaIndexDirty = true;
+}
+
+
+TreeInfo::~TreeInfo()
+{
+    if (lcaIndex)
+        delete lcaIndex;
 }
 
 
@@ -26,6 +36,8 @@ void TreeInfo::OnLabelChanged(Node* n, string oldLabel, string newLabel)
 
 void TreeInfo::OnNodeInserted(Node* n, int pos)
 {
+    lcaIndexDirty = true;
+
     if (!n->IsRoot())
     {
         if (n->GetParent()->GetNbChildren() > degree)
@@ -105,6 +117,7 @@ int TreeInfo::GetDegree()
 
 void TreeInfo::OnNodeDeleted()
 {
+    lcaIndexDirty = true;
     ParseTree(this->GetRoot(), false, true, true);
 }
 
@@ -119,10 +132,8 @@ void TreeInfo::ParseTree(Node* node, bool nameEmptyLabels, bool computeDepth, bo
     if (computePathBits)
         pathBitNodes.clear();
 
-    TreeIterator* it = node->GetPreOrderIterator();
-
     int cpt = 1;
-    while (Node* n = it->next())
+    for (Node* n : node->PreOrder())
     {
         if (nameEmptyLabels && n->GetLabel() == "")
         {
@@ -165,8 +176,6 @@ void TreeInfo::ParseTree(Node* node, bool nameEmptyLabels, bool computeDepth, bo
 
 
     }
-
-    node->CloseIterator(it);
 }
 
 
@@ -200,7 +209,29 @@ Node* TreeInfo::GetNodeByLabel(string label)
 
 
 
+LCAIndex* TreeInfo::GetLCAIndex()
+{
+    if (lcaIndexDirty || !lcaIndex)
+    {
+        if (lcaIndex)
+            delete lcaIndex;
+        lcaIndex = new LCAIndex(root);
+        lcaIndexDirty = false;
+    }
+
+    return lcaIndex;
+}
+
+
+
 Node* TreeInfo::GetLCA(Node* n1, Node* n2)
+{
+    return GetLCAIndex()->GetLCA(n1, n2);
+}
+
+
+
+Node* TreeInfo::GetLCAWithPathBits(Node* n1, Node* n2)
 {
     if (n1->GetPathBits() == 0)
         this->ParseTree(NULL, false, true, true);
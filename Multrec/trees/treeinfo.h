@@ -14,6 +14,7 @@
 #define STATE_LOSS 2
 
 class Node;
+class LCAIndex;
 
 using namespace std;
 
@@ -22,8 +23,9 @@ using namespace std;
   A TreeInfo is associated with a tree, and maintains information on the whole tree.
   If a tree was created with maintainTreeInfo = true, any node in the tree can returns the tree info using
   Node::GetTreeInfo().
-  The main usage is to find LCA quickly (if the height < 64),
-  getting the max degree of the tree, finding a node by label quickly.
+  The main usage is to find LCA quickly, getting the max degree of the tree, finding a node by label quickly.
+  LCA queries use an LCAIndex, which works for any depth and degree.  The index is built on the first query
+  and rebuilt on the first query following a modification of the tree.
   **/
 class TreeInfo
 {
@@ -35,9 +37,15 @@ private:
     Node* root;
     int degree;
 
+    //built lazily by GetLCA, and set dirty whenever nodes are inserted or deleted
+    LCAIndex* lcaIndex;
+    bool lcaIndexDirty;
+
 public:
     TreeInfo(Node* root);
 
+    ~TreeInfo();
+
     /**
       Returns, as expected, the root of the tree
       **/
@@ -73,10 +81,23 @@ public:
     void ParseTree(Node* node = NULL, bool nameEmptyLabels = false, bool computeDepth = false, bool computePathBits = false);
 
     /**
-      Returns the lowest common ancestor of n1, n2 in constant time.
+      Returns the lowest common ancestor of n1, n2 in constant time (after an O(n log n) rebuild of the
+      index if the tree was modified since the last query).
       **/
     Node* GetLCA(Node* n1, Node* n2);
 
+    /**
+      Returns the lowest common ancestor of n1, n2 using path bits, as GetLCA did before the LCAIndex.
+      Only valid on binary trees of height < 64.  Kept for comparison purposes (see --bench).
+      **/
+    Node* GetLCAWithPathBits(Node* n1, Node* n2);
+
+    /**
+      Returns the LCAIndex of the tree, (re)building it if needed.  The returned index must not be deleted,
+      and becomes invalid when the tree is modified.
+      **/
+    LCAIndex* GetLCAIndex();
+
     /**
       Returns the lowest common ancestor of all passed nodes, in O(|nodes|) time.
       **/
@@ -84,7 +105,7 @@ public:
 
     /**
       Path bits are used to find LCA in constant time.  Each node has a unique path bit string.
-      This is mainly used by GetLCA
+      This is mainly used by GetLCAWithPathBits
       **/
     Node* GetNodeByPathBits(uint64 pathbits);
 
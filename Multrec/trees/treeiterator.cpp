@@ -122,7 +122,7 @@ Node* PostOrderTreeIterator::DeleteCurrent()
 
     deadNode->RemoveChildren(false);
 
-    delete deadNode;
+    Node::DeleteNode(deadNode);
 
     return curNode;
 }
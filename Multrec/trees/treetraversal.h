@@ -0,0 +1,203 @@
+#ifndef TREETRAVERSAL_H
+#define TREETRAVERSAL_H
+
+#include "node.h"
+
+using namespace std;
+
+class Node;
+
+/**
+  Post-order traversal of a subtree, to be used in a range-based for loop:
+  @code
+  for (Node* n : my_node->PostOrder())
+  {
+    //do fascinating stuff
+  }
+  @endcode
+  Unlike Node::GetPostOrderIterator, it needs no closing, makes no heap allocation and no virtual call.  Only the current
+  node is kept: the next one is found with the parent and the position of the current node (see Node::GetChildIndex).
+  The tree must not be modified during the traversal: use a TreeIterator to delete nodes on the way.
+  **/
+class PostOrderTraversal
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(Node* root, bool leavesOnly)
+        {
+            this->root = root;
+            this->leavesOnly = leavesOnly;
+            this->curNode = root;
+
+            if (curNode)
+                GoToFirstLeaf();
+        }
+
+        Node* operator*()
+        {
+            return curNode;
+        }
+
+        Iterator& operator++()
+        {
+            do
+            {
+                if (curNode == root)
+                {
+                    curNode = NULL;
+                    break;
+                }
+
+                int position = curNode->GetChildIndex() + 1;
+                Node* parent = curNode->GetParent();
+                if (position < parent->GetNbChildren())
+                {
+                    curNode = parent->GetChild(position);
+                    GoToFirstLeaf();
+                }
+                else
+                {
+                    curNode = parent;
+                }
+            }
+            while (leavesOnly && !curNode->IsLeaf());
+
+            return *this;
+        }
+
+        bool operator!=(const Iterator &it)
+        {
+            return (curNode != it.curNode);
+        }
+
+    private:
+        Node* root;
+        Node* curNode;
+        bool leavesOnly;
+
+        //goes down to the leftmost leaf under curNode
+        void GoToFirstLeaf()
+        {
+            while (!curNode->IsLeaf())
+            {
+                curNode = curNode->GetChild(0);
+            }
+        }
+    };
+
+    PostOrderTraversal(Node* root, bool leavesOnly = false)
+    {
+        this->root = root;
+        this->leavesOnly = leavesOnly;
+    }
+
+    Iterator begin()
+    {
+        return Iterator(root, leavesOnly);
+    }
+
+    Iterator end()
+    {
+        return Iterator(NULL, leavesOnly);
+    }
+
+private:
+    Node* root;
+    bool leavesOnly;
+};
+
+
+
+/**
+  Pre-order traversal of a subtree, to be used in a range-based for loop.  See PostOrderTraversal.
+  **/
+class PreOrderTraversal
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(Node* root, bool leavesOnly)
+        {
+            this->root = root;
+            this->leavesOnly = leavesOnly;
+            this->curNode = root;
+
+            if (curNode && leavesOnly && !curNode->IsLeaf())
+                ++(*this);
+        }
+
+        Node* operator*()
+        {
+            return curNode;
+        }
+
+        Iterator& operator++()
+        {
+            do
+            {
+                if (!curNode->IsLeaf())
+                {
+                    curNode = curNode->GetChild(0);
+                    continue;
+                }
+
+                //go up to the first ancestor that has a next sibling, and move to that sibling
+                while (curNode)
+                {
+                    if (curNode == root)
+                    {
+                        curNode = NULL;
+                        break;
+                    }
+
+                    int position = curNode->GetChildIndex() + 1;
+                    Node* parent = curNode->GetParent();
+                    if (position < parent->GetNbChildren())
+                    {
+                        curNode = parent->GetChild(position);
+                        break;
+                    }
+                    curNode = parent;
+                }
+            }
+            while (curNode && leavesOnly && !curNode->IsLeaf());
+
+            return *this;
+        }
+
+        bool operator!=(const Iterator &it)
+        {
+            return (curNode != it.curNode);
+        }
+
+    private:
+        Node* root;
+        Node* curNode;
+        bool leavesOnly;
+    };
+
+    PreOrderTraversal(Node* root, bool leavesOnly = false)
+    {
+        this->root = root;
+        this->leavesOnly = leavesOnly;
+    }
+
+    Iterator begin()
+    {
+        return Iterator(root, leavesOnly);
+    }
+
+    Iterator end()
+    {
+        return Iterator(NULL, leavesOnly);
+    }
+
+private:
+    Node* root;
+    bool leavesOnly;
+};
+
+#endif // TREETRAVERSAL_H